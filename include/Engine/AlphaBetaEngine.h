@@ -0,0 +1,190 @@
+#pragma once
+
+#include "Engine/IEngine.h"
+#include "Engine/ThreadPool.h"
+#include "Engine/TranspositionTable.h"
+#include <atomic>
+#include <deque>
+
+namespace Chess {
+
+/**
+ * Iterative-deepening alpha-beta search over turns.
+ * A turn is searched move by move on the allocation-free doMove / undoMove path: moves within a turn keep the
+ * player to move, and once no moveable board is left the turn is submitted with doSubmit and the opponent's
+ * score is negated, as in negamax. The depth counts turns.
+ *
+ * Like TurnSolver, each node settles the board given by choosePivot and gives up on the partial turn when there
+ * is none.
+ * Moves are ordered by the transposition table move, captures (most valuable victim first), promotions, killer
+ * moves and the history heuristic. After the first move of a turn only the first turnWidth completions of each
+ * node are searched, which keeps the number of turns polynomial in the number of boards.
+ *
+ * With several threads the search is Lazy SMP: every thread searches the root on its own snapshot of the game,
+ * half of the helpers one turn deeper than the main thread, and they only share the transposition table, so
+ * a thread mostly finds the subtrees another one already searched in the table. The main thread's result is
+ * returned, and the helpers stop with it.
+ */
+class AlphaBetaEngine : public IEngine {
+public:
+  static constexpr std::size_t DEFAULT_HASH_MEGABYTES = 16;
+  static constexpr int DEFAULT_TURN_WIDTH = 8;
+  static constexpr int MAX_DEPTH = 64;
+
+  /**
+   * Construct an engine.
+   * @param threads The number of threads searching, see setThreads.
+   * @param hashMegabytes The size of the transposition table.
+   */
+  explicit AlphaBetaEngine(int threads = 1, std::size_t hashMegabytes = DEFAULT_HASH_MEGABYTES);
+
+  ~AlphaBetaEngine(void) override;
+
+  inline std::string name(void) const override {
+    return "Alpha-beta";
+  }
+
+  SearchResult findBestTurn(const IGame& game, const SearchLimits& limits) override;
+
+  inline void stop(void) override {
+    _stop.store(true, std::memory_order_relaxed);
+  }
+
+  /**
+   * Set the number of threads searching, between searches.
+   * @param threads The number of threads, at least 1. The node limit counts the moves of every thread.
+   */
+  void setThreads(int threads);
+
+  inline int threads(void) const {
+    return int(_workers.size());
+  }
+
+  /**
+   * Change the size of the transposition table, between searches. Its entries are lost.
+   * @param megabytes The size of the table.
+   */
+  inline void setHashSize(std::size_t megabytes) {
+    _table.resize(megabytes);
+  }
+
+  inline std::size_t hashSize(void) const {
+    return _table.bytes();
+  }
+
+  /**
+   * Set how many completions of a partial turn are searched once the first move of the turn is made.
+   * @param width The number of completions, at least 1.
+   */
+  inline void setTurnWidth(int width) {
+    assert(width > 0);
+    _turnWidth = width;
+  }
+
+  /**
+   * Get the evaluation of the leaves, to tune its weights between searches.
+   * The scores stored in the transposition table are not updated, see clear.
+   */
+  inline Evaluator& evaluator(void) {
+    return _evaluator;
+  }
+
+  /**
+   * Forget the transposition table, killer moves and history, e.g. when a new game starts.
+   */
+  void clear(void);
+private:
+  /**
+   * The per-move state of a search, kept between searches so that searching does not allocate.
+   */
+  struct _Ply {
+    std::vector<PackedMove> moves; // the LEGAL moves of every moveable board
+    std::vector<int> scores; // ordering score of each move of the pivot board
+    std::vector<int> order; // indices into moves, the moves of the pivot board
+    std::array<PackedMove, 2> killers;
+  };
+
+  /**
+   * One thread of the search, with its own game and ordering heuristics.
+   */
+  struct _Worker {
+    AlphaBetaEngine& engine;
+    int ID; // 0 for the main thread
+    std::shared_ptr<IGame> game;
+    std::deque<_Ply> plies;
+    MoveBuffer buffer; // the moves of one board, see generateTurnMoves
+    std::vector<int> boards; // the moveable boards, for choosePivot
+    std::vector<int> options; // scratch space of choosePivot
+    std::array<std::array<std::array<int, 64>, 64>, 2> history{}; // [color][from square][to square]
+    std::vector<PackedMove> rootTurn; // the best turn of the running iteration
+    int rootScore = 0;
+    std::size_t rootMade = 0; // the moves of the current turn made before the search
+    u64 nodes = 0;
+    u64 unreported = 0; // nodes not yet added to the engine's count
+    bool aborted = false;
+    SearchResult result;
+
+    _Worker(AlphaBetaEngine& engine, int ID) : engine(engine), ID(ID) {}
+
+    /**
+     * Search a game by iterative deepening until a limit is reached or the engine stops, filling result.
+     * @param root The game to search, a snapshot of it is searched.
+     */
+    void run(const IGame& root);
+
+    /**
+     * Search the turn of the player to move and the turns after it.
+     * @param depth The number of turns left.
+     * @param alpha The score the player is already sure of.
+     * @param beta The score the opponent is already sure of.
+     * @param turnPly The number of turns made since the root.
+     * @param ply The number of moves made since the root.
+     * @return The score for the player to move, mate scores included when the player has no legal turn.
+     */
+    int searchTurn(int depth, int alpha, int beta, int turnPly, int ply);
+
+    /**
+     * Search the completions of the current partial turn.
+     * Parameters as in searchTurn.
+     * @return The score of the best completion, NO_TURN if there is none.
+     */
+    int searchMoves(int depth, int alpha, int beta, int turnPly, int ply);
+
+    /**
+     * Score a move for ordering, higher first.
+     */
+    int orderScore(PackedMove move, PackedMove hashMove, const _Ply& node) const;
+
+    inline _Ply& plyAt(int index) {
+      while (int(plies.size()) <= index) {
+        plies.emplace_back();
+      }
+      return plies[index];
+    }
+
+    /**
+     * Count a node and raise aborted once a limit is reached.
+     */
+    inline void countNode(void) {
+      nodes += 1;
+      unreported += 1;
+      if (unreported == 1024) {
+        checkLimits();
+      }
+    }
+
+    void checkLimits(void);
+  };
+
+  TranspositionTable _table;
+  ThreadPool _pool;
+  std::vector<std::unique_ptr<_Worker>> _workers; // one per thread of the pool
+  Evaluator _evaluator;
+  int _turnWidth = DEFAULT_TURN_WIDTH;
+  SearchLimits _limits;
+  std::chrono::steady_clock::time_point _start;
+  std::atomic<bool> _stop{false};
+  std::atomic<u64> _nodes{0}; // the nodes of every thread, reported every 1024 nodes
+};
+
+} // namespace Chess
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "chess.h"
+
+namespace Chess {
+
+/**
+ * The weights of the terms of the evaluation beyond the boards' own scores.
+ */
+struct EvaluationWeights {
+  int timeLine = 40; // centipawns per timeline created beyond the opponent's
+  int presentLine = 25; // percent of the score of the boards at the present added once more, they are played next
+};
+
+/**
+ * Static evaluation of a game, for the engines.
+ * Only the playable boards count, the tips of the timelines: every board keeps the material and positional value
+ * of its pieces up to date as they are placed (Board::score) and the game keeps the sum over its tips as boards
+ * are pushed and popped (IGame::tipsScore), so make / unmake keep the evaluation current and evaluating a
+ * position only visits the boards at the present.
+ */
+class Evaluator {
+public:
+  explicit Evaluator(const EvaluationWeights& weights = EvaluationWeights()) : _weights(weights) {}
+
+  inline void setWeights(const EvaluationWeights& weights) {
+    _weights = weights;
+  }
+
+  inline const EvaluationWeights& weights(void) const {
+    return _weights;
+  }
+
+  /**
+   * Evaluate a game.
+   * @param game The game.
+   * @return The score in centipawns for the player to move.
+   */
+  int evaluate(const IGame& game) const;
+private:
+  EvaluationWeights _weights;
+};
+
+} // namespace Chess
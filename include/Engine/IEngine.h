@@ -0,0 +1,81 @@
+#pragma once
+
+#include "chess.h"
+#include "Engine/Evaluator.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Chess {
+
+inline constexpr int MATE_SCORE = 1000000; // the score of a player without a legal turn while in check
+inline constexpr int MATE_BOUND = MATE_SCORE - 10000; // scores beyond it announce a mate, closer mates score higher
+
+/**
+ * Generate the LEGAL moves of the moveable boards one board at a time, so that no move is dropped however many
+ * boards are in play.
+ * @param game The game.
+ * @param moves Receives the moves, it is cleared first and grows with the position.
+ * @param boards Receives the timelines of the moveable boards.
+ * @param buffer Scratch space for the moves of one board.
+ * @return False if the moves of a board did not fit in the buffer. The list then misses moves, so a board that
+ * choosePivot finds stuck says nothing about the partial turn.
+ */
+bool generateTurnMoves(const IGame& game, std::vector<PackedMove>& moves, std::vector<int>& boards, MoveBuffer& buffer);
+
+/**
+ * Get the value of the piece a move captures.
+ * @return The value in centipawns, 0 if the move captures nothing.
+ */
+int captureValue(const IGame& game, PackedMove move);
+
+/**
+ * How much a search may spend. A limit of zero is no limit, the search stops at the first limit it reaches.
+ */
+struct SearchLimits {
+  int depth = 0; // turns, those of both players count
+  u64 nodes = 0; // moves made during the search
+  std::chrono::milliseconds time{0};
+};
+
+/**
+ * The outcome of a search.
+ */
+struct SearchResult {
+  std::vector<PackedMove> turn; // the moves completing the current turn in play order, empty without a legal turn
+  int score = 0; // centipawns for the player to move
+  int depth = 0; // the deepest iteration the search completed
+  u64 nodes = 0;
+  double seconds = 0;
+};
+
+/**
+ * A computer player.
+ * Engines search their own snapshot of the game (see IGame::snapshot), so the game given to findBestTurn can
+ * be rendered or played on meanwhile. Making the moves of the result then submitting the turn plays it.
+ */
+class IEngine {
+public:
+  virtual ~IEngine(void) = default;
+
+  /**
+   * Get the name of the engine.
+   * @return The name shown to the player.
+   */
+  virtual std::string name(void) const = 0;
+
+  /**
+   * Search the best turn of the player to move.
+   * @param game The game, on top of the moves already made in the current turn. It is not modified.
+   * @param limits When to stop searching.
+   * @return The best turn found.
+   */
+  virtual SearchResult findBestTurn(const IGame& game, const SearchLimits& limits) = 0;
+
+  /**
+   * Stop the running search as soon as possible, from any thread. findBestTurn then returns the best turn found so far.
+   */
+  virtual void stop(void) = 0;
+};
+
+} // namespace Chess
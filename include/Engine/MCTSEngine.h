@@ -0,0 +1,271 @@
+#pragma once
+
+#include "Engine/IEngine.h"
+#include "Engine/ThreadPool.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+namespace Chess {
+
+/**
+ * How the moves of a playout are chosen.
+ */
+struct PlayoutPolicy {
+  enum Kind : u8 {
+    UNIFORM, // any legal move of the board settled next
+    CAPTURES_FIRST, // the capture of the most valuable piece, else a promotion, else any legal move
+  };
+
+  Kind kind = CAPTURES_FIRST;
+  int turns = 2; // turns played before the evaluation decides, 0 to evaluate the leaf right away
+};
+
+/**
+ * Monte Carlo tree search over moves.
+ * A node of the tree is a position, its children are the moves settling one moveable board (chosen as in
+ * TurnSolver), so a turn spans several levels of the tree and a child whose move completes the turn hands the
+ * next level to the opponent. Partial turns without a legal completion are found when expanding and pruned from
+ * the tree. Nodes are selected by UCT, the leaf is expanded and a playout of a few turns follows the playout
+ * policy, then the evaluation gives the result, squashed to [0, 1].
+ *
+ * Every thread of the pool walks the same tree on its own snapshot of the game, with doMove / doSubmit and the
+ * matching undo. A thread adds a virtual loss to the nodes it walks through until its result is backed up, which
+ * steers the other threads to other branches. The nodes live in one preallocated pool, the children of a node
+ * being a contiguous range of it claimed with one atomic increment, and the statistics are atomics, so threads
+ * only wait on each other when they expand the same node: the first one expands it, the others play out from it.
+ */
+class MCTSEngine : public IEngine {
+public:
+  static constexpr std::size_t DEFAULT_NODE_CAPACITY = 1 << 19;
+  static constexpr double DEFAULT_EXPLORATION = 1.4;
+  static constexpr int DEFAULT_VIRTUAL_LOSS = 3;
+  static constexpr u64 DEFAULT_ITERATIONS = 20000; // when no node or time limit is given
+
+  /**
+   * Construct an engine.
+   * @param threads The number of threads walking the tree.
+   * @param nodeCapacity The number of nodes of the pool. Once it is full the tree stops growing and the search
+   * goes on with playouts from its leaves.
+   */
+  explicit MCTSEngine(int threads = 1, std::size_t nodeCapacity = DEFAULT_NODE_CAPACITY);
+
+  ~MCTSEngine(void) override;
+
+  inline std::string name(void) const override {
+    return "Monte Carlo";
+  }
+
+  /**
+   * Search the best turn. SearchLimits::depth is not a limit of the tree search, without node or time limit
+   * the search runs DEFAULT_ITERATIONS playouts. The turn is the most visited one, its score comes from its
+   * average result.
+   */
+  SearchResult findBestTurn(const IGame& game, const SearchLimits& limits) override;
+
+  inline void stop(void) override {
+    _stop.store(true, std::memory_order_relaxed);
+  }
+
+  /**
+   * Set the number of threads walking the tree, between searches.
+   * @param threads The number of threads, at least 1.
+   */
+  void setThreads(int threads);
+
+  inline int threads(void) const {
+    return int(_workers.size());
+  }
+
+  /**
+   * Set the number of nodes of the pool, between searches.
+   * @param nodes The number of nodes, at least 1.
+   */
+  void setNodeCapacity(std::size_t nodes);
+
+  inline void setPlayoutPolicy(const PlayoutPolicy& policy) {
+    _policy = policy;
+  }
+
+  inline const PlayoutPolicy& playoutPolicy(void) const {
+    return _policy;
+  }
+
+  /**
+   * Set the exploration constant of UCT, higher values visit the less promising moves more often.
+   */
+  inline void setExploration(double exploration) {
+    _exploration = exploration;
+  }
+
+  /**
+   * Set the number of losses a thread walking through a node adds to it until its playout is backed up.
+   */
+  inline void setVirtualLoss(int losses) {
+    assert(losses >= 0);
+    _virtualLoss = losses;
+  }
+
+  /**
+   * Get the evaluation ending the playouts, to tune its weights between searches.
+   */
+  inline Evaluator& evaluator(void) {
+    return _evaluator;
+  }
+private:
+  enum NodeState : u8 {
+    UNEXPANDED,
+    EXPANDING, // a thread is creating the children
+    EXPANDED,
+    TERMINAL, // the player to move has no legal turn
+    DEAD, // a partial turn without legal completion
+  };
+
+  enum TurnOutcome : u8 {
+    PLAYED,
+    NO_TURN, // the player to move has no legal turn
+    GAVE_UP, // every try ended in a partial turn without legal completion, or a board had too many moves to list
+  };
+
+  static constexpr double RESULT_SCALE = 1 << 16; // results are summed in fixed point
+  static constexpr double RESULT_SPREAD = 400; // the lead, in centipawns, worth a result of about 0.73
+  static constexpr int PLAYOUT_TRIES = 4; // tries to complete a turn during a playout
+
+  struct _Node {
+    PackedMove move; // the move leading to the node
+    PieceColor mover = PieceColor::PIECEWHITE; // the player who made the move
+    std::atomic<NodeState> state{UNEXPANDED};
+    std::atomic<u8> terminalResult{0}; // in TERMINAL state, the result for white times 2 (0 loss, 1 draw, 2 win)
+    std::atomic<u32> visits{0};
+    std::atomic<u32> virtualLosses{0};
+    std::atomic<u64> results{0}; // the sum of the results for the mover, times RESULT_SCALE
+    u32 firstChild = 0; // the index of the first child in the pool, published by the EXPANDED state
+    u32 childCount = 0;
+
+    void reset(PackedMove move, PieceColor mover);
+  };
+
+  /**
+   * The state of one thread.
+   */
+  struct _Worker {
+    std::shared_ptr<IGame> game; // the thread's snapshot during a search
+    std::vector<PackedMove> moves; // the LEGAL moves of every moveable board
+    MoveBuffer buffer; // the moves of one board, see generateTurnMoves
+    std::vector<int> boards; // the moveable boards, for choosePivot
+    std::vector<int> options; // scratch space of choosePivot
+    std::vector<std::pair<int, PackedMove>> children; // scratch space of _expand, the moves with their order
+    std::vector<u32> path; // the nodes walked from the root
+    std::vector<bool> submitted; // per move made, whether the turn was submitted after it
+    int rootMade = 0; // the moves of the current turn made before the search
+    int turns = 0; // the turns submitted on top of the root
+    u64 random = 0;
+    u64 nodes = 0;
+    u64 unreported = 0; // the nodes not yet added to the engine's count
+  };
+
+  ThreadPool _pool;
+  std::vector<std::unique_ptr<_Worker>> _workers; // one per thread of the pool
+  std::unique_ptr<_Node[]> _nodes;
+  std::size_t _capacity = 0;
+  std::atomic<u32> _used{0}; // the nodes of the pool in use, the root is node 0
+  PlayoutPolicy _policy;
+  Evaluator _evaluator;
+  double _exploration = DEFAULT_EXPLORATION;
+  int _virtualLoss = DEFAULT_VIRTUAL_LOSS;
+  SearchLimits _limits;
+  std::chrono::steady_clock::time_point _start;
+  std::atomic<bool> _stop{false};
+  std::atomic<u64> _iterations{0};
+  std::atomic<u64> _moves{0}; // the moves made by every thread, reported after each playout
+
+  /**
+   * Walk the tree until a limit is reached or the engine stops.
+   * @param worker The thread's state.
+   * @param root The game to search, the thread searches its own snapshot of it.
+   */
+  void _run(_Worker& worker, const IGame& root);
+
+  /**
+   * Select a leaf, expand it, play out from it and back the result up, leaving the game as found.
+   */
+  void _iterate(_Worker& worker);
+
+  /**
+   * Choose the child of a node to walk to, by UCT counting the virtual losses.
+   * @return The index of the child in the pool, 0 if every child is DEAD.
+   */
+  u32 _select(const _Node& node) const;
+
+  /**
+   * Create the children of a node in EXPANDING state, for the current position of the worker's game.
+   * The node ends TERMINAL or DEAD when the position has no move to try, and UNEXPANDED again when the pool is full
+   * or the moves of a board did not fit in the worker's buffer.
+   */
+  void _expand(_Worker& worker, _Node& node);
+
+  /**
+   * Mark a node whose moves all failed, TERMINAL at the start of a turn and DEAD within one.
+   */
+  void _settle(_Worker& worker, _Node& node);
+
+  /**
+   * Play a few turns following the playout policy, then take them back.
+   * @return The result for white, between 0 and 1.
+   */
+  double _playout(_Worker& worker);
+
+  /**
+   * Complete the current turn following the playout policy.
+   * @return PLAYED once the turn is submitted, otherwise the moves made are taken back.
+   */
+  TurnOutcome _playTurn(_Worker& worker);
+
+  /**
+   * Choose one of the worker's moves settling the pivot board.
+   * @param greedy Whether to take the most valuable capture or promotion first, otherwise the choice is uniform.
+   */
+  PackedMove _playoutMove(_Worker& worker, int pivot, bool greedy);
+
+  /**
+   * Make a move on the worker's game, submitting the turn once it is complete.
+   * @return False if the move completes a turn that leaves the player in check, the move is then taken back.
+   * Only the moves made before the search were not checked by the LEGAL filter.
+   */
+  bool _make(_Worker& worker, PackedMove move);
+
+  /**
+   * Take back the last move made with _make.
+   */
+  void _unmake(_Worker& worker);
+
+  /**
+   * Collect the moves of the most visited turn from the root.
+   * @param game The game searched, TurnSolver completes the turn if the tree ends before it does.
+   * @param result Receives the turn, its score and the number of turns of the most visited line.
+   */
+  void _bestTurn(const IGame& game, SearchResult& result) const;
+
+  bool _limitReached(void) const;
+
+  /**
+   * Get the result for white of a position, from its evaluation.
+   */
+  inline double _evaluate(const IGame& game) const {
+    int score = _evaluator.evaluate(game);
+    if (game.getCurrentTurnColor() != PieceColor::PIECEWHITE) {
+      score = -score;
+    }
+    return 1.0 / (1.0 + std::exp(-score / RESULT_SPREAD));
+  }
+
+  static inline u64 _nextRandom(u64& state) {
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+};
+
+} // namespace Chess
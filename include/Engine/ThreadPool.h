@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chess {
+
+/**
+ * A fixed set of threads that run one job at a time, each thread with its own index.
+ * The threads are started once and wait between jobs, so a search does not pay for creating threads.
+ */
+class ThreadPool {
+public:
+  /**
+   * Construct a pool.
+   * @param size The number of threads running a job, the thread calling run included.
+   */
+  explicit ThreadPool(int size = 1);
+
+  ~ThreadPool(void);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * Change the number of threads, while no job runs.
+   * @param size The number of threads, the thread calling run included, at least 1.
+   */
+  void resize(int size);
+
+  inline int size(void) const {
+    return int(_threads.size()) + 1;
+  }
+
+  /**
+   * Run a job on every thread and wait for all of them.
+   * @param job Called once with each index from 0 to size() - 1, index 0 on the calling thread.
+   */
+  void run(const std::function<void(int)>& job);
+private:
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _done;
+  const std::function<void(int)>* _job = nullptr;
+  unsigned _generation = 0; // incremented with each job, a thread runs a job once
+  int _pending = 0; // the threads of the pool still running the job
+  bool _quit = false;
+
+  /**
+   * The body of a thread of the pool.
+   * @param index The index the thread passes to the jobs.
+   * @param seen The generation of the last job, the thread waits for the next one.
+   */
+  void _loop(int index, unsigned seen);
+  void _stopThreads(void);
+};
+
+} // namespace Chess
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "chess.h"
+#include <atomic>
+#include <memory>
+
+namespace Chess {
+
+/**
+ * A transposition table shared by the threads of a search, without locks.
+ * Entries are grouped in buckets of one cache line, the bucket of a position is chosen by its Zobrist hash
+ * (IGame::hash) and the entry within it by the key. Each entry is three words written and read with relaxed
+ * atomics: the move, the data (score, depth, bound, generation) and a check holding the key XORed with both.
+ * A thread reading an entry while another writes it sees words of two different entries, so the check no
+ * longer matches the key and the entry is ignored rather than trusted.
+ */
+class TranspositionTable {
+public:
+  static constexpr int BUCKET_SIZE = 2;
+
+  enum Bound : u8 {
+    UPPER = 1,
+    LOWER = 2,
+    EXACT = UPPER | LOWER,
+  };
+
+  /**
+   * What a probe found.
+   */
+  struct Entry {
+    PackedMove move;
+    int score = 0;
+    int depth = -1;
+    Bound bound = EXACT;
+  };
+
+  /**
+   * Construct a table.
+   * @param megabytes The size of the table, rounded down to a power of two number of buckets.
+   */
+  explicit TranspositionTable(std::size_t megabytes);
+
+  /**
+   * Change the size of the table, forgetting every entry. No search may be running.
+   * @param megabytes The size of the table.
+   */
+  void resize(std::size_t megabytes);
+
+  /**
+   * Forget every entry. No search may be running.
+   */
+  void clear(void);
+
+  /**
+   * Start a new search, so that entries of older searches are replaced first.
+   */
+  inline void newSearch(void) {
+    _generation = (_generation + 1) & GENERATION_MASK;
+  }
+
+  /**
+   * Look a position up.
+   * @param key The hash of the position.
+   * @param entry Receives the entry of the position.
+   * @return True if the table holds an entry for the key.
+   */
+  bool probe(u64 key, Entry& entry) const;
+
+  /**
+   * Record a position, replacing the entry of the same key, or else the shallowest entry of the bucket, older
+   * searches first.
+   * @param key The hash of the position.
+   * @param entry What to record.
+   */
+  void store(u64 key, const Entry& entry);
+
+  /**
+   * Get the size of the table.
+   * @return The number of bytes held by the buckets.
+   */
+  inline std::size_t bytes(void) const {
+    return _bucketCount * sizeof(_Bucket);
+  }
+private:
+  static constexpr u64 GENERATION_MASK = 0xff;
+
+  struct _Slot {
+    std::atomic<u64> check{0}; // key ^ move ^ data
+    std::atomic<u64> move{0};
+    std::atomic<u64> data{0}; // score in bits 0-31, depth in 32-39, bound in 40-47, generation in 48-55
+  };
+
+  struct alignas(64) _Bucket {
+    std::array<_Slot, BUCKET_SIZE> slots;
+  };
+
+  std::unique_ptr<_Bucket[]> _buckets;
+  std::size_t _bucketCount = 0;
+  u64 _generation = 0;
+
+  static inline u64 _pack(const Entry& entry, u64 generation) {
+    return u64(u32(entry.score)) | u64(u8(entry.depth)) << 32 | u64(entry.bound) << 40 | generation << 48;
+  }
+
+  inline _Bucket& _bucketOf(u64 key) const {
+    return _buckets[key & (_bucketCount - 1)];
+  }
+};
+
+} // namespace Chess
@@ -12,6 +12,12 @@
 #include <iostream>
 #include <climits>
 #include <algorithm>
+#include <bit>
+#include <type_traits>
+#include <memory_resource>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace Chess {
 
@@ -62,6 +68,284 @@ inline constexpr PieceColor opposite(PieceColor c) {
   return c == PieceColor::PIECEWHITE ? PieceColor::PIECEBLACK : PieceColor::PIECEWHITE;
 }
 
+enum class PieceType : int {
+  PIECEKING = 0,
+  PIECEQUEEN = 1,
+  PIECEROOK = 2,
+  PIECEBISHOP = 3,
+  PIECEKNIGHT = 4,
+  PIECEPAWN = 5,
+};
+
+inline constexpr int PIECE_TYPE_COUNT = 6;
+
+/**
+ * Compact piece encoding used inside boards and by move generation.
+ * Bit 0 holds the color and bits 1-3 hold the piece type plus one, so 0 always means an empty square.
+ */
+using PieceCode = u8;
+
+inline constexpr PieceCode EMPTY_SQUARE = 0;
+
+inline constexpr PieceCode makePieceCode(PieceType type, PieceColor color) {
+  return PieceCode(((int(type) + 1) << 1) | int(color));
+}
+
+inline constexpr PieceType pieceTypeOf(PieceCode code) {
+  return PieceType((code >> 1) - 1);
+}
+
+inline constexpr PieceColor pieceColorOf(PieceCode code) {
+  return PieceColor(code & 1);
+}
+
+/**
+ * Get the name of a piece type.
+ * @param type The type of the piece.
+ * @return The same name as Piece::name() of the matching class ("king", "queen", ...).
+ */
+inline const std::string& pieceTypeName(PieceType type) {
+  static const std::array<std::string, PIECE_TYPE_COUNT> names = {"king", "queen", "rook", "bishop", "knight", "pawn"};
+  return names[int(type)];
+}
+
+inline constexpr PieceCode WHITE_KING = makePieceCode(PieceType::PIECEKING, PieceColor::PIECEWHITE);
+inline constexpr PieceCode WHITE_QUEEN = makePieceCode(PieceType::PIECEQUEEN, PieceColor::PIECEWHITE);
+inline constexpr PieceCode WHITE_ROOK = makePieceCode(PieceType::PIECEROOK, PieceColor::PIECEWHITE);
+inline constexpr PieceCode WHITE_BISHOP = makePieceCode(PieceType::PIECEBISHOP, PieceColor::PIECEWHITE);
+inline constexpr PieceCode WHITE_KNIGHT = makePieceCode(PieceType::PIECEKNIGHT, PieceColor::PIECEWHITE);
+inline constexpr PieceCode WHITE_PAWN = makePieceCode(PieceType::PIECEPAWN, PieceColor::PIECEWHITE);
+inline constexpr PieceCode BLACK_KING = makePieceCode(PieceType::PIECEKING, PieceColor::PIECEBLACK);
+inline constexpr PieceCode BLACK_QUEEN = makePieceCode(PieceType::PIECEQUEEN, PieceColor::PIECEBLACK);
+inline constexpr PieceCode BLACK_ROOK = makePieceCode(PieceType::PIECEROOK, PieceColor::PIECEBLACK);
+inline constexpr PieceCode BLACK_BISHOP = makePieceCode(PieceType::PIECEBISHOP, PieceColor::PIECEBLACK);
+inline constexpr PieceCode BLACK_KNIGHT = makePieceCode(PieceType::PIECEKNIGHT, PieceColor::PIECEBLACK);
+inline constexpr PieceCode BLACK_PAWN = makePieceCode(PieceType::PIECEPAWN, PieceColor::PIECEBLACK);
+
+/**
+ * Zobrist keys identifying positions.
+ * All keys derive from splitmix64 at compile time, so hashes are identical across runs and builds.
+ */
+namespace Zobrist {
+inline constexpr u64 mix(u64 value) {
+  value += 0x9e3779b97f4a7c15ULL;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+inline constexpr int SQUARE_COUNT = 64;
+inline constexpr int CODE_COUNT = 16;
+
+// PIECE_KEYS[square][code], the row of EMPTY_SQUARE is all zeros so clearing a square needs no special case
+inline constexpr std::array<std::array<u64, CODE_COUNT>, SQUARE_COUNT> PIECE_KEYS = [] {
+  std::array<std::array<u64, CODE_COUNT>, SQUARE_COUNT> keys{};
+  for (int square = 0; square < SQUARE_COUNT; square += 1) {
+    for (int code = 1; code < CODE_COUNT; code += 1) {
+      keys[square][code] = mix(u64(square * CODE_COUNT + code));
+    }
+  }
+  return keys;
+}();
+
+inline constexpr u64 BLACK_TO_MOVE_KEY = mix(0x5ee0b1ac4ULL);
+
+/**
+ * Get the key of a piece on a square.
+ * @param square The bit index of the square.
+ * @param code The code of the piece.
+ * @return The key to XOR into the hash of the board.
+ */
+inline constexpr u64 pieceKey(int square, PieceCode code) {
+  return PIECE_KEYS[square][code];
+}
+
+/**
+ * Get the key of a board placed at a coordinate of the multiverse.
+ * @param boardHash The hash of the board.
+ * @param timeLineID The ID of the timeline of the board.
+ * @param halfTurn The half turn of the board.
+ * @return The key to XOR into the hash of the multiverse.
+ */
+inline constexpr u64 boardSlotKey(u64 boardHash, int timeLineID, int halfTurn) {
+  return mix(boardHash ^ mix((u64(u32(timeLineID)) << 32) | u32(halfTurn)));
+}
+
+/**
+ * Get the key of the present half turn.
+ * @param halfTurn The present half turn.
+ * @return The key to XOR into the hash of the multiverse.
+ */
+inline constexpr u64 presentKey(int halfTurn) {
+  return mix(~u64(u32(halfTurn)));
+}
+} // namespace Zobrist
+
+/**
+ * Static values of pieces, summed by every board as pieces are placed (see Board::score).
+ * The positional part depends on the size of the board, so there is one table per size.
+ */
+namespace Evaluation {
+inline constexpr int DIM_COUNT = 9; // board sizes up to 8
+
+// indexed by PieceType, in centipawns; the king is never captured by a legal turn
+inline constexpr std::array<int, PIECE_TYPE_COUNT> PIECE_VALUES = {0, 900, 500, 330, 320, 100};
+
+/**
+ * Get the positional bonus of a piece.
+ * @param type The type of the piece.
+ * @param dim The size of the board.
+ * @param file The x coordinate of the piece.
+ * @param rank The y coordinate of the piece, counted from its owner's side of the board.
+ * @return The bonus in centipawns.
+ */
+inline constexpr int positionalBonus(PieceType type, int dim, int file, int rank) {
+  int fromEdge = std::min(file, dim - 1 - file);
+  int centre = fromEdge + std::min(rank, dim - 1 - rank);
+  switch (type) {
+  case PieceType::PIECEKING:
+    return -4 * centre - 8 * std::min(rank, 2);
+  case PieceType::PIECEQUEEN:
+    return 2 * centre;
+  case PieceType::PIECEROOK:
+    return rank == dim - 2 ? 15 : 0;
+  case PieceType::PIECEBISHOP:
+    return 3 * centre;
+  case PieceType::PIECEKNIGHT:
+    return 5 * centre - 10;
+  case PieceType::PIECEPAWN:
+    return 5 * std::max(rank - 1, 0) + 2 * fromEdge;
+  }
+  return 0;
+}
+
+// PIECE_SQUARE[dim][code][square], the value plus the positional bonus, negated for black; the row of EMPTY_SQUARE is all zeros
+inline constexpr std::array<std::array<std::array<int16_t, Zobrist::SQUARE_COUNT>, Zobrist::CODE_COUNT>, DIM_COUNT> PIECE_SQUARE = [] {
+  std::array<std::array<std::array<int16_t, Zobrist::SQUARE_COUNT>, Zobrist::CODE_COUNT>, DIM_COUNT> tables{};
+  for (int dim = 1; dim < DIM_COUNT; dim += 1) {
+    for (int type = 0; type < PIECE_TYPE_COUNT; type += 1) {
+      for (PieceColor color : {PieceColor::PIECEWHITE, PieceColor::PIECEBLACK}) {
+        PieceCode code = makePieceCode(PieceType(type), color);
+        for (int x = 0; x < dim; x += 1) {
+          for (int y = 0; y < dim; y += 1) {
+            int rank = color == PieceColor::PIECEWHITE ? y : dim - 1 - y;
+            int value = PIECE_VALUES[type] + positionalBonus(PieceType(type), dim, x, rank);
+            tables[dim][code][x * 8 + y] = int16_t(color == PieceColor::PIECEWHITE ? value : -value);
+          }
+        }
+      }
+    }
+  }
+  return tables;
+}();
+
+/**
+ * Get the value of a piece on a square.
+ * @param dim The size of the board.
+ * @param square The bit index of the square.
+ * @param code The code of the piece.
+ * @return The value to add to the score of the board, positive for white.
+ */
+inline constexpr int pieceSquare(int dim, int square, PieceCode code) {
+  return PIECE_SQUARE[dim][code][square];
+}
+} // namespace Evaluation
+
+/**
+ * A step through the multiverse: x and y on the board, z in full turns, w in timelines.
+ */
+struct Offset4D {
+  int8_t x, y, z, w;
+};
+
+/**
+ * Movement tables of every piece, built at compile time.
+ * Rays that stay on one board (z == 0 and w == 0) are listed too, though the generators handle them with bitboards.
+ */
+namespace Directions {
+/**
+ * Build the 80 queen directions, grouped by the number of axes they touch.
+ * The axes of a direction are the set bits of its mask (x = 1, y = 2, z = 4, w = 8), each touched axis takes both signs.
+ */
+inline constexpr std::array<Offset4D, 80> makeQueenDirections(void) {
+  std::array<Offset4D, 80> directions{};
+  int count = 0;
+  for (int axes = 1; axes <= 4; axes += 1) {
+    for (int mask = 1; mask < 16; mask += 1) {
+      if (std::popcount(unsigned(mask)) != axes) continue;
+      for (int signs = 0; signs < 16; signs += 1) {
+        if (signs & ~mask) continue;
+        int step[4];
+        for (int axis = 0; axis < 4; axis += 1) {
+          step[axis] = (mask >> axis & 1) ? ((signs >> axis & 1) ? -1 : +1) : 0;
+        }
+        directions[count++] = Offset4D{int8_t(step[0]), int8_t(step[1]), int8_t(step[2]), int8_t(step[3])};
+      }
+    }
+  }
+  return directions;
+}
+
+inline constexpr std::array<Offset4D, 80> QUEEN = makeQueenDirections();
+// QUEEN[QUEEN_GROUP[k - 1] .. QUEEN_GROUP[k]) are the directions touching exactly k axes
+inline constexpr std::array<int, 5> QUEEN_GROUP = {0, 8, 32, 64, 80};
+
+// Rook moves along one axis, but never into the future
+inline constexpr std::array<Offset4D, 7> ROOK = {{
+  {+1, 0, 0, 0}, {-1, 0, 0, 0}, {0, +1, 0, 0}, {0, -1, 0, 0},
+  {0, 0, -1, 0}, {0, 0, 0, +1}, {0, 0, 0, -1},
+}};
+
+// Bishop moves along two axes, but never into the future
+inline constexpr std::array<Offset4D, 18> BISHOP = {{
+  {+1, +1, 0, 0}, {+1, -1, 0, 0}, {-1, +1, 0, 0}, {-1, -1, 0, 0},
+  {+1, 0, -1, 0}, {-1, 0, -1, 0}, {0, +1, -1, 0}, {0, -1, -1, 0},
+  {+1, 0, 0, +1}, {+1, 0, 0, -1}, {-1, 0, 0, +1}, {-1, 0, 0, -1},
+  {0, +1, 0, +1}, {0, +1, 0, -1}, {0, -1, 0, +1}, {0, -1, 0, -1},
+  {0, 0, -1, +1}, {0, 0, -1, -1},
+}};
+
+/**
+ * Build the 53 king steps: one square along any set of axes, staying in the present or going one turn back.
+ */
+inline constexpr std::array<Offset4D, 53> makeKingSteps(void) {
+  std::array<Offset4D, 53> steps{};
+  int count = 0;
+  for (int dx = -1; dx <= +1; dx += 1)
+  for (int dy = -1; dy <= +1; dy += 1)
+  for (int dz = -1; dz <= 0; dz += 1)
+  for (int dw = -1; dw <= +1; dw += 1) {
+    if (dx == 0 && dy == 0 && dz == 0 && dw == 0) continue;
+    steps[count++] = Offset4D{int8_t(dx), int8_t(dy), int8_t(dz), int8_t(dw)};
+  }
+  return steps;
+}
+
+inline constexpr std::array<Offset4D, 53> KING = makeKingSteps();
+
+/**
+ * Build the 48 knight leaps: two squares along one axis and one along another.
+ */
+inline constexpr std::array<Offset4D, 48> makeKnightLeaps(void) {
+  std::array<Offset4D, 48> leaps{};
+  int count = 0;
+  for (int axis2 = 0; axis2 < 4; axis2 += 1)
+  for (int axis1 = 0; axis1 < 4; axis1 += 1) {
+    if (axis1 == axis2) continue;
+    for (int s2 : {-1, +1})
+    for (int s1 : {-1, +1}) {
+      int step[4] = {0, 0, 0, 0};
+      step[axis2] = 2 * s2;
+      step[axis1] = s1;
+      leaps[count++] = Offset4D{int8_t(step[0]), int8_t(step[1]), int8_t(step[2]), int8_t(step[3])};
+    }
+  }
+  return leaps;
+}
+
+inline constexpr std::array<Offset4D, 48> KNIGHT = makeKnightLeaps();
+} // namespace Directions
+
 class Position2D;
 class Piece;
 class Board;
@@ -119,6 +403,20 @@ public:
     return _color;
   }
 
+  /**
+   * Get the type of the piece.
+   * @return The type of the piece as a PieceType enum.
+   */
+  virtual PieceType type(void) const = 0;
+
+  /**
+   * Get the compact code of the piece.
+   * @return The PieceCode encoding the type and color of the piece.
+   */
+  inline PieceCode code(void) const {
+    return makePieceCode(type(), _color);
+  }
+
   /**
    * Get the name of the piece.
    * @return The name of the piece as a string.
@@ -137,9 +435,9 @@ public:
    * Get the board this piece is on.
    * @return A shared pointer to the Board object this piece is on.
    * This method returns the board that this piece is currently placed on.
-   * If the piece is not on any board, it returns a null pointer.
+   * If the piece is not on any board, or the board was released, it returns a null pointer.
    */
-  inline std::shared_ptr<Board> getBoard(void) const { return _board; }
+  inline std::shared_ptr<Board> getBoard(void) const { return _board.lock(); }
 
   /**
    * Get the position of this piece on the board.
@@ -162,7 +460,7 @@ public:
   }
 protected:
   PieceColor _color;
-  std::shared_ptr<Board> _board;
+  std::weak_ptr<Board> _board; // pieces are views of a board, they do not keep it alive
   Position2D _position;
 };
 
@@ -175,6 +473,10 @@ public:
     return std::make_shared<King>(*this);
   }
 
+  inline PieceType type(void) const override {
+    return PieceType::PIECEKING;
+  }
+
   inline const std::string& name(void) const override {
     static const std::string name = "king";
     return name;
@@ -195,6 +497,10 @@ public:
     return std::make_shared<Queen>(*this);
   }
 
+  inline PieceType type(void) const override {
+    return PieceType::PIECEQUEEN;
+  }
+
   inline const std::string& name(void) const override {
     static const std::string name = "queen";
     return name;
@@ -215,6 +521,10 @@ public:
     return std::make_shared<Rook>(*this);
   }
 
+  inline PieceType type(void) const override {
+    return PieceType::PIECEROOK;
+  }
+
   inline const std::string& name(void) const override {
     static const std::string name = "rook";
     return name;
@@ -235,6 +545,10 @@ public:
     return std::make_shared<Bishop>(*this);
   }
 
+  inline PieceType type(void) const override {
+    return PieceType::PIECEBISHOP;
+  }
+
   inline const std::string& name(void) const override {
     static const std::string name = "bishop";
     return name;
@@ -255,6 +569,10 @@ public:
     return std::make_shared<Knight>(*this);
   }
 
+  inline PieceType type(void) const override {
+    return PieceType::PIECEKNIGHT;
+  }
+
   inline const std::string& name(void) const override {
     static const std::string name = "knight";
     return name;
@@ -275,6 +593,10 @@ public:
     return std::make_shared<Pawn>(*this);
   }
 
+  inline PieceType type(void) const override {
+    return PieceType::PIECEPAWN;
+  }
+
   inline const std::string& name(void) const override {
     static const std::string name = "pawn";
     return name;
@@ -286,10 +608,201 @@ public:
   }
 };
 
+/**
+ * Create a piece object from its code.
+ * @param code The code of the piece, must not be EMPTY_SQUARE.
+ * @param board The board the piece is on, if any.
+ * @param position The position of the piece on the board, if any.
+ * @return A shared pointer to the newly created piece.
+ * The Piece hierarchy is a facade over PieceCode, boards and move generation only deal in codes.
+ */
+std::shared_ptr<Piece> makePiece(PieceCode code, std::shared_ptr<Board> board = nullptr, Position2D position = Position2D(-1, -1));
+
+/**
+ * The piece placement of a board, as a plain value.
+ * Kept trivially copyable so that forking a board is a single fixed-size copy with no allocation
+ * besides the board itself.
+ */
+struct BoardPosition {
+  std::array<std::array<u64, PIECE_TYPE_COUNT>, 2> pieceMasks{}; // indexed by [color][type]
+  std::array<u64, 2> colorMasks{}; // indexed by color
+  u64 hash = 0; // XOR of Zobrist::pieceKey over the occupied squares
+  int score = 0; // sum of Evaluation::pieceSquare over the occupied squares
+};
+static_assert(std::is_trivially_copyable_v<BoardPosition>);
+
+/**
+ * A bump allocator owned by one game.
+ * Boards and timelines of the game are carved out of large chunks, deallocation of a single object is a
+ * no-op and every chunk is released at once when the arena is destroyed.
+ * Allocation is not thread-safe, a game must only be mutated from one thread at a time.
+ */
+class GameArena {
+public:
+  explicit GameArena(std::size_t initialSize = 64 * 1024);
+
+  inline void* allocate(std::size_t bytes, std::size_t alignment) {
+    _bytesAllocated += bytes;
+    return _resource.allocate(bytes, alignment);
+  }
+
+  inline void deallocate(void*, std::size_t, std::size_t) {}
+
+  /**
+   * Get the number of bytes handed out by the arena.
+   * @return The total size of all allocations made from the arena.
+   */
+  inline std::size_t bytesAllocated(void) const {
+    return _bytesAllocated;
+  }
+private:
+  std::pmr::monotonic_buffer_resource _resource;
+  std::size_t _bytesAllocated;
+};
+
+/**
+ * Standard allocator adaptor over a GameArena.
+ * Each allocator shares ownership of the arena, so objects created through std::allocate_shared keep it
+ * alive even if they outlive their game (e.g. boards still held by the renderer).
+ */
+template<class T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(std::shared_ptr<GameArena> arena) : _arena(std::move(arena)) {}
+
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.arena()) {}
+
+  inline T* allocate(std::size_t n) {
+    return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  inline void deallocate(T* p, std::size_t n) {
+    _arena->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  inline const std::shared_ptr<GameArena>& arena(void) const {
+    return _arena;
+  }
+
+  template<class U>
+  inline bool operator==(const ArenaAllocator<U>& other) const {
+    return _arena == other.arena();
+  }
+private:
+  std::shared_ptr<GameArena> _arena;
+};
+
+/**
+ * Create an object in an arena.
+ * @param arena The arena to allocate from, or nullptr to fall back to the global heap.
+ * @param args The arguments forwarded to the constructor of T.
+ * @return A shared pointer to the newly created object.
+ */
+template<class T, class... Args>
+std::shared_ptr<T> arenaMakeShared(const std::shared_ptr<GameArena>& arena, Args&&... args) {
+  if (arena == nullptr) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+  return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
+
+/**
+ * A piece standing on a square.
+ */
+struct PlacedPiece {
+  Position2D position;
+  PieceCode code;
+};
+
+/**
+ * The pieces of one color on a board, as an iterable snapshot of its piece masks.
+ * Iterating costs O(pieces) and yields pieces grouped by type, kings first.
+ */
+class PieceList {
+public:
+  class Iterator {
+  public:
+    Iterator(const std::array<u64, PIECE_TYPE_COUNT>& masks, PieceColor color, int type) : _masks(masks), _color(color), _type(type) {
+      _skipEmpty();
+    }
+
+    inline PlacedPiece operator*(void) const;
+
+    inline Iterator& operator++(void) {
+      _masks[_type] &= _masks[_type] - 1;
+      _skipEmpty();
+      return *this;
+    }
+
+    inline bool operator==(const Iterator& other) const {
+      return _type == other._type and (_type == PIECE_TYPE_COUNT or _masks[_type] == other._masks[_type]);
+    }
+  private:
+    std::array<u64, PIECE_TYPE_COUNT> _masks;
+    PieceColor _color;
+    int _type;
+
+    inline void _skipEmpty(void) {
+      while (_type < PIECE_TYPE_COUNT and _masks[_type] == 0) {
+        _type += 1;
+      }
+    }
+  };
+
+  PieceList(const std::array<u64, PIECE_TYPE_COUNT>& masks, PieceColor color) : _masks(masks), _color(color) {}
+
+  inline Iterator begin(void) const { return Iterator(_masks, _color, 0); }
+  inline Iterator end(void) const { return Iterator(_masks, _color, PIECE_TYPE_COUNT); }
+
+  inline int size(void) const {
+    int count = 0;
+    for (u64 mask : _masks) {
+      count += std::popcount(mask);
+    }
+    return count;
+  }
+private:
+  std::array<u64, PIECE_TYPE_COUNT> _masks;
+  PieceColor _color;
+};
+
+/**
+ * A chess board backed by bitboards.
+ * Every variant is at most 8x8, so each square maps to one bit of a u64 (square = x * 8 + y).
+ * The board keeps one occupancy mask per (color, piece type) plus one per color; Piece objects
+ * are only materialized on demand by getPiece. The masks double as piece lists (see pieces()) and king
+ * square cache (see kingSquare()), both kept up to date by placePiece and copied by createFork.
+ * A fork copies the parent's BoardPosition by value and records which squares it changed since.
+ */
 class Board : public std::enable_shared_from_this<Board> {
+  friend class TimeLine;
+  friend class IGame;
 public:
+  static constexpr int MAX_DIM = 8;
+
   Board(int N, std::shared_ptr<TimeLine> timeLine, int halfTurnNumber = 0);
 
+  /**
+   * Get the bit index of a position.
+   * @param position The position on the board.
+   * @return The index of the bit representing the position in the occupancy masks.
+   */
+  inline static int squareOf(Position2D position) {
+    return position.x() * MAX_DIM + position.y();
+  }
+
+  /**
+   * Get the position of a bit index.
+   * @param square The index of the bit in the occupancy masks.
+   * @return The position represented by the bit.
+   */
+  inline static Position2D positionOf(int square) {
+    return Position2D(square / MAX_DIM, square % MAX_DIM);
+  }
+
   /**
    * Get the dimension of the board.
    * @return The dimension of the board as an integer.
@@ -302,24 +815,145 @@ public:
   /**
    * Place a piece on the board.
    * @param position The position on the board where the piece will be placed.
-   * @param piece The piece to be placed on the board.
+   * @param code The code of the piece to be placed, or EMPTY_SQUARE to clear the square.
    * This method asserts that the position is within the bounds of the board
-   * Please note that this method transfers ownership of the piece to the board.
    */
-  void placePiece(Position2D position, std::shared_ptr<Piece> piece);
+  void placePiece(Position2D position, PieceCode code);
+
+  /**
+   * Place a piece on the board.
+   * @param position The position on the board where the piece will be placed.
+   * @param piece The piece to be placed on the board, or nullptr to clear the square.
+   * Please note that the board only records the code of the piece, the object itself is not kept.
+   */
+  inline void placePiece(Position2D position, std::shared_ptr<Piece> piece) {
+    placePiece(position, piece ? piece->code() : EMPTY_SQUARE);
+  }
 
   /**
    * Get a piece from the board.
    * @param position The position on the board from which to retrieve the piece.
-   * @return A shared pointer to the Piece object at the specified position, or nullptr if no piece is present.
+   * @return A shared pointer to a Piece object describing the specified position, or nullptr if no piece is present.
+   * A new Piece object is created on each call, prefer pieceAt / colorAt on hot paths.
    */
   std::shared_ptr<Piece> getPiece(Position2D position) const;
 
   /**
-   * Get the timeline this board belongs to.
-   * @return A shared pointer to the TimeLine object associated with this board.
+   * Get the code of the piece on a square.
+   * @param position The position on the board.
+   * @return The PieceCode of the piece on the position, or EMPTY_SQUARE if no piece is present.
+   */
+  inline PieceCode pieceAt(Position2D position) const {
+    u64 bit = u64(1) << squareOf(position);
+    for (int color = 0; color < 2; color += 1) {
+      if (not (_state.colorMasks[color] & bit)) continue;
+      for (int type = 0; type < PIECE_TYPE_COUNT; type += 1) {
+        if (_state.pieceMasks[color][type] & bit) {
+          return makePieceCode(PieceType(type), PieceColor(color));
+        }
+      }
+    }
+    return EMPTY_SQUARE;
+  }
+
+  /**
+   * Get the mask of all occupied squares.
+   * @return The occupancy mask of the board.
+   */
+  inline u64 occupancy(void) const {
+    return _state.colorMasks[0] | _state.colorMasks[1];
+  }
+
+  /**
+   * Get the mask of squares occupied by pieces of a color.
+   * @param color The color of the pieces.
+   * @return The occupancy mask of the color.
+   */
+  inline u64 colorMask(PieceColor color) const {
+    return _state.colorMasks[int(color)];
+  }
+
+  /**
+   * Get the mask of squares occupied by pieces of a type and color.
+   * @param type The type of the pieces.
+   * @param color The color of the pieces.
+   * @return The occupancy mask of the piece type and color.
+   */
+  inline u64 pieceMask(PieceType type, PieceColor color) const {
+    return _state.pieceMasks[int(color)][int(type)];
+  }
+
+  /**
+   * Check whether a square is occupied.
+   * @param position The position on the board.
+   * @return True if a piece stands on the position, false otherwise.
+   */
+  inline bool isOccupied(Position2D position) const {
+    return (occupancy() >> squareOf(position)) & 1;
+  }
+
+  /**
+   * Get the pieces of a color.
+   * @param color The color of the pieces.
+   * @return An iterable list of the pieces with their squares, built from the piece masks in O(1).
+   */
+  inline PieceList pieces(PieceColor color) const {
+    return PieceList(_state.pieceMasks[int(color)], color);
+  }
+
+  /**
+   * Get the square of a king.
+   * @param color The color of the king.
+   * @return The square of the king of that color, or std::nullopt if there is none.
+   * Variants may hold several kings of one color, use pieceMask(PieceType::PIECEKING, color) to get them all.
+   */
+  inline std::optional<Position2D> kingSquare(PieceColor color) const {
+    u64 kings = _state.pieceMasks[int(color)][int(PieceType::PIECEKING)];
+    if (kings == 0) {
+      return std::nullopt;
+    }
+    return positionOf(std::countr_zero(kings));
+  }
+
+  /**
+   * Get the color of the piece on a square.
+   * @param position The position on the board.
+   * @return The color of the piece on the position, or std::nullopt if the square is empty.
+   */
+  inline std::optional<PieceColor> colorAt(Position2D position) const {
+    u64 bit = u64(1) << squareOf(position);
+    if (_state.colorMasks[0] & bit) return PieceColor::PIECEWHITE;
+    if (_state.colorMasks[1] & bit) return PieceColor::PIECEBLACK;
+    return std::nullopt;
+  }
+
+  /**
+   * Get the squares reachable by sliding from a position in one direction.
+   * @param from The starting position (excluded from the result).
+   * @param dx The step along the x axis.
+   * @param dy The step along the y axis.
+   * @return The mask of squares along the ray, up to and including the first occupied square.
+   */
+  u64 rayMask(Position2D from, int dx, int dy) const;
+
+  /**
+   * Get the squares attacked by the pieces of a color without leaving the board.
+   * @param color The color of the attacking pieces.
+   * @return The mask of squares a piece of that color standing on this board could capture on, including
+   * squares held by its own pieces. Attacks through time and timelines are resolved by IGame::isSquareAttacked.
+   * The mask is computed once, when the board is appended to its timeline; boards are not modified afterwards.
+   */
+  inline u64 attacks(PieceColor color) const {
+    return _attacks[int(color)];
+  }
+
+  /**
+   * Get the ID of the timeline this board belongs to.
+   * @return The ID of the timeline. The board does not refer to the timeline object, which belongs to the game:
+   * a board shared with a snapshot (see IGame::snapshot) is in the timeline of that ID in both games, index
+   * IGame::getTimeLines of the game at hand with it.
    */
-  std::shared_ptr<TimeLine> getTimeLine() const;
+  inline int timeLineID(void) const { return _timeLineID; }
 
   /**
    * Get the full turn number of the board.
@@ -333,18 +967,89 @@ public:
    */
   inline int halfTurnNumber(void) const { return _halfTurnNumber; }
 
+  /**
+   * Get the piece placement of the board.
+   * @return A reference to the BoardPosition value of the board.
+   */
+  inline const BoardPosition& state(void) const { return _state; }
+
+  /**
+   * Get the Zobrist hash of the board.
+   * @return The hash of the piece placement, maintained incrementally by placePiece.
+   * Two boards with the same placement have the same hash regardless of where they are in the multiverse.
+   */
+  inline u64 hash(void) const { return _state.hash; }
+
+  /**
+   * Get the static score of the board.
+   * @return The material and positional value of the pieces, white minus black, maintained incrementally by
+   * placePiece (see Evaluation::pieceSquare).
+   */
+  inline int score(void) const { return _state.score; }
+
+  /**
+   * Get the squares modified since the board was forked.
+   * @return The mask of squares written by placePiece since createFork (every placed square for a root board).
+   */
+  inline u64 changedSquares(void) const { return _changedSquares; }
+
+  /**
+   * Fork the board into the next half turn.
+   * @param timeLine The timeline the forked board belongs to.
+   * @return A new board with the same pieces and the half turn number incremented by one.
+   * The fork does not keep a reference to its parent.
+   */
   std::shared_ptr<Board> createFork(std::shared_ptr<TimeLine> timeLine);
 private:
   int _N;
   int _halfTurnNumber;
-  std::shared_ptr<Board> _previousBoard;
-  std::vector<std::vector<std::shared_ptr<Piece>>> _pieces;
-  std::shared_ptr<TimeLine> _timeLine; // The timeline this board belongs to
+  BoardPosition _state;
+  u64 _changedSquares;
+  std::array<u64, 2> _attacks; // on-board attack masks indexed by color, see attacks()
+  int _timeLineID;
+
+  void _updateAttacks(void);
+
+  /**
+   * Turn this board into the fork of another one, reusing its storage.
+   * @param parent The board to fork.
+   * @param timeLine The timeline the board belongs to from now on.
+   */
+  void _forkFrom(const Board& parent, std::shared_ptr<TimeLine> timeLine);
+};
+
+inline PlacedPiece PieceList::Iterator::operator*(void) const {
+  return PlacedPiece{Board::positionOf(std::countr_zero(_masks[_type])), makePieceCode(PieceType(_type), _color)};
+}
+
+/**
+ * How a timeline stores the boards of its history.
+ * SNAPSHOT keeps every board alive, DELTA keeps a keyframe board every few half turns plus the tip and
+ * stores the squares changed by each other half turn, rebuilding those boards on demand.
+ */
+enum class HistoryMode {
+  SNAPSHOT,
+  DELTA
+};
+
+/**
+ * The squares a board changed relative to the previous board of its timeline.
+ */
+struct BoardDelta {
+  static constexpr int MAX_CHANGES = 4; // a move touches at most two squares of a board, boards changing more become keyframes
+
+  u8 count = 0;
+  std::array<u8, MAX_CHANGES> squares{};
+  std::array<PieceCode, MAX_CHANGES> codes{};
 };
 
 class TimeLine : public std::enable_shared_from_this<TimeLine> {
+  friend class IGame;
 public:
-  TimeLine(int N, int IDX = 0, int forkAt = -1);
+  static constexpr int DEFAULT_KEYFRAME_INTERVAL = 16;
+  static constexpr int MATERIALIZED_CACHE_SIZE = 8;
+
+  TimeLine(int N, int IDX = 0, int forkAt = -1, std::shared_ptr<GameArena> arena = nullptr);
 
   /**
    * Get the ID of the timeline.
@@ -371,13 +1076,38 @@ public:
     return _forkAt;
   }
 
+  /**
+   * Get the arena the boards of the timeline are allocated from.
+   * @return A shared pointer to the arena, or nullptr if boards are allocated on the global heap.
+   */
+  inline const std::shared_ptr<GameArena>& arena(void) const {
+    return _arena;
+  }
+
+  /**
+   * Get the history mode of the timeline.
+   * @return The way boards of the timeline are stored.
+   */
+  inline HistoryMode historyMode(void) const {
+    return _historyMode;
+  }
+
+  /**
+   * Change the history mode of the timeline.
+   * @param mode The new history mode.
+   * @param keyframeInterval In DELTA mode, the number of half turns between two keyframes.
+   * The existing history is re-encoded. Boards handed out before a switch to DELTA mode stay valid but
+   * the timeline stops keeping them alive, so the UI should stay in SNAPSHOT mode as it keys views by board.
+   */
+  void setHistoryMode(HistoryMode mode, int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
   /**
    * Get the full turn number of the timeline.
    * @return The full turn number of the timeline as an integer.
    */
   inline int fullTurnNumber(void) const {
     assert(_history.size() > 0);
-    return _history.back()->fullTurnNumber();
+    return _history.back().board->fullTurnNumber();
   }
 
   /**
@@ -386,7 +1116,7 @@ public:
    */
   inline int halfTurnNumber(void) const {
     assert(_history.size() > 0);
-    return _history.back()->halfTurnNumber();
+    return _history.back().board->halfTurnNumber();
   }
 
   /**
@@ -394,7 +1124,7 @@ public:
    * @return A shared pointer to the parent timeline, or nullptr if there is no parent.
    */
   inline std::shared_ptr<const TimeLine> parent(void) const {
-    return _parent;
+    return _parent.lock();
   }
 
   inline int size(void) const {
@@ -404,39 +1134,164 @@ public:
   /**
    * Push a new board state onto the timeline.
    * @param board The board state to be added to the timeline.
+   * In DELTA mode the previous tip is reduced to its delta unless it is a keyframe.
    */
   void pushBack(std::shared_ptr<Board> board);
 
-  inline void popBack(void) {
-    assert(!_history.empty());
-    _history.pop_back();
-  }
+  /**
+   * Remove the last board of the timeline.
+   * In DELTA mode the new tip is materialized again if needed.
+   */
+  void popBack(void);
 
   inline std::shared_ptr<Board> back(void) {
     assert(!_history.empty());
-    return _history.back();
+    return _history.back().board;
   }
 
-  inline std::shared_ptr<Board> getBoardByHalfTurn(int halfTurn) const {
+  /**
+   * Get the board of a half turn.
+   * @param halfTurn The half turn of the board.
+   * @return A shared pointer to the board, rebuilt from the closest keyframe if it is not resident.
+   */
+  std::shared_ptr<Board> getBoardByHalfTurn(int halfTurn) const;
+
+  /**
+   * Get the board of a half turn if it is kept in memory.
+   * @param halfTurn The half turn of the board.
+   * @return A pointer to the board, or nullptr if the board is only stored as a delta.
+   * Resident boards stay alive as long as they remain in the history, in SNAPSHOT mode every board is resident.
+   */
+  inline Board* residentBoard(int halfTurn) const {
     int pos = halfTurn - _forkAt - 1;
-    assert(pos >= 0 && pos < _history.size());
-    return _history[pos];
+    assert(pos >= 0 && pos < int(_history.size()));
+    return _history[pos].board.get();
   }
 
   std::shared_ptr<TimeLine> createFork(int newID, int forkAt) {
-    std::shared_ptr<TimeLine> forkedTimeLine = std::make_shared<TimeLine>(_N, newID);
-    forkedTimeLine->_forkAt = forkAt;
-    forkedTimeLine->_parent = shared_from_this();
+    std::shared_ptr<TimeLine> forkedTimeLine = arenaMakeShared<TimeLine>(_arena, _N, newID, forkAt, _arena);
+    forkedTimeLine->_forkFrom(shared_from_this(), newID, forkAt);
     return forkedTimeLine;
   }
 private:
+  struct HistoryEntry {
+    std::shared_ptr<Board> board; // null if the board is only stored as a delta
+    BoardDelta delta;
+    bool keyframe;
+  };
+
   int _N;
   int _ID;
   int _forkAt;
-  std::vector<std::shared_ptr<Board>> _history;
-  std::shared_ptr<TimeLine> _parent;
+  HistoryMode _historyMode;
+  int _keyframeInterval;
+  std::vector<HistoryEntry> _history;
+  std::weak_ptr<TimeLine> _parent; // owned by the game, like this timeline
+  std::shared_ptr<GameArena> _arena;
+  // Recently rebuilt boards, most recent first. Only touched from the thread that owns the game.
+  mutable std::vector<std::pair<int, std::shared_ptr<Board>>> _materialized;
+
+  std::shared_ptr<Board> _materialize(int pos) const;
+
+  /**
+   * Turn this empty timeline into a fork of another one, keeping the storage of its history.
+   * @param parent The timeline to fork.
+   * @param newID The ID of the timeline.
+   * @param forkAt The half turn of the parent board the timeline branches off.
+   */
+  void _forkFrom(std::shared_ptr<TimeLine> parent, int newID, int forkAt);
+
+  /**
+   * Copy the timeline, sharing its boards.
+   * @param parent The copy of the parent timeline, or nullptr for a root timeline.
+   * @param arena The arena of the game the copy belongs to.
+   * @return A timeline with the same history, whose pushes and pops do not affect this one.
+   */
+  std::shared_ptr<TimeLine> _share(std::shared_ptr<TimeLine> parent, std::shared_ptr<GameArena> arena) const;
+public:
+  std::vector<std::shared_ptr<Board>> getBoards() const;
+};
+
+/**
+ * A dense table of boards addressed by (timeline ID, half turn).
+ * Cells live in one contiguous row-major array with a validity bitmap alongside, so looking a board up
+ * costs one bounds check and one load no matter where its timeline forked.
+ * The index holds non-owning pointers, the boards are owned by the histories of their timelines.
+ * A cell may be valid but hold no pointer when its timeline only keeps the board as a delta.
+ */
+class MultiverseIndex {
 public:
-  std::vector<std::shared_ptr<Board>> getBoards() const { return _history; }
+  MultiverseIndex(void) : _timeLineCount(0), _stride(0) {}
+
+  /**
+   * Get the number of timelines in the index.
+   * @return The number of rows of the table.
+   */
+  inline int timeLineCount(void) const {
+    return _timeLineCount;
+  }
+
+  /**
+   * Get the board at a coordinate.
+   * @param timeLineID The ID of the timeline.
+   * @param halfTurn The half turn of the board.
+   * @return A pointer to the board, or nullptr if there is no board at the coordinate.
+   */
+  inline Board* at(int timeLineID, int halfTurn) const {
+    if (unsigned(timeLineID) >= unsigned(_timeLineCount) or unsigned(halfTurn) >= unsigned(_stride)) {
+      return nullptr;
+    }
+    return _cells[timeLineID * _stride + halfTurn];
+  }
+
+  /**
+   * Check whether a board exists at a coordinate.
+   * @param timeLineID The ID of the timeline.
+   * @param halfTurn The half turn of the board.
+   * @return True if the coordinate holds a board, false otherwise.
+   */
+  inline bool exists(int timeLineID, int halfTurn) const {
+    if (unsigned(timeLineID) >= unsigned(_timeLineCount) or unsigned(halfTurn) >= unsigned(_stride)) {
+      return false;
+    }
+    int cell = timeLineID * _stride + halfTurn;
+    return (_valid[cell / 64] >> (cell % 64)) & 1;
+  }
+
+  /**
+   * Append an empty row for a new timeline.
+   */
+  void addTimeLine(void);
+
+  /**
+   * Remove the row of the last timeline, which must be empty.
+   */
+  void removeTimeLine(void);
+
+  /**
+   * Set the board at a coordinate.
+   * @param timeLineID The ID of the timeline.
+   * @param halfTurn The half turn of the board.
+   * @param board The board to store, or nullptr if the board is not resident.
+   * @param valid Whether a board exists at the coordinate.
+   * The table widens itself when halfTurn is beyond the current width.
+   */
+  void set(int timeLineID, int halfTurn, Board* board, bool valid);
+
+  /**
+   * Get the memory held by the table.
+   * @return The size of the storage of the cells and of the validity bitmap, in bytes.
+   */
+  inline std::size_t memoryUsage(void) const {
+    return _cells.capacity() * sizeof(Board*) + _valid.capacity() * sizeof(u64);
+  }
+private:
+  int _timeLineCount;
+  int _stride; // number of half turns per row, a multiple of 64
+  std::vector<Board*> _cells;
+  std::vector<u64> _valid;
+
+  void _grow(int minStride);
 };
 
 struct SelectedPosition {
@@ -447,7 +1302,22 @@ struct SelectedPosition {
   SelectedPosition(std::shared_ptr<Board> b, Position2D pos) : board(b), position(pos) {}
 
   inline Vector4D toVector4D(void) const {
-    return Vector4D(position.x(), position.y(), board->fullTurnNumber(), board->getTimeLine()->ID());
+    return Vector4D(position.x(), position.y(), board->fullTurnNumber(), board->timeLineID());
+  }
+};
+
+/**
+ * A compact destination of a move: a square of the board at (timeLine, halfTurn).
+ * Unlike SelectedPosition it holds no reference to the board, so it can be written to plain buffers.
+ */
+struct MoveTarget {
+  u16 timeLine;
+  u16 halfTurn;
+  u8 x;
+  u8 y;
+
+  inline Position2D position(void) const {
+    return Position2D(x, y);
   }
 };
 
@@ -460,30 +1330,188 @@ public:
   // Additional fields can be added, e.g., piece type, but keeping simple for now
 };
 
-class RuleEngine {
+/**
+ * A move packed into 64 bits, trivially copyable and free of board references.
+ * Layout from the low bits: from x (3), from y (3), to x (3), to y (3), from timeline (10), to timeline (10),
+ * from half turn (12), to half turn (12), flags (8).
+ * Use IGame::pack / IGame::unpack to convert from and to Move.
+ */
+class PackedMove {
 public:
-  bool pawnCanMakeTwoMoveOnFirstTurn = true;
-};
+  static constexpr int MAX_TIMELINES = 1 << 10;
+  static constexpr int MAX_HALF_TURNS = 1 << 12;
+
+  enum Flag : u8 {
+    CAPTURE = 1 << 0, // a piece stands on the target square
+    PROMOTION = 1 << 1, // a pawn reaches the last rank
+    TIME_TRAVEL = 1 << 2, // the target is on another board
+    BRANCHING = 1 << 3, // the target board is not the tip of its timeline, the move creates a timeline
+  };
+
+  constexpr PackedMove(void) : _bits(0) {}
+
+  PackedMove(int fromTimeLine, int fromHalfTurn, Position2D from, int toTimeLine, int toHalfTurn, Position2D to, u8 flags = 0)
+      : _bits(u64(from.x()) | u64(from.y()) << 3 | u64(to.x()) << 6 | u64(to.y()) << 9
+            | u64(fromTimeLine) << 12 | u64(toTimeLine) << 22
+            | u64(fromHalfTurn) << 32 | u64(toHalfTurn) << 44 | u64(flags) << 56) {
+    assert(from.x() >= 0 && from.x() < 8 && from.y() >= 0 && from.y() < 8);
+    assert(to.x() >= 0 && to.x() < 8 && to.y() >= 0 && to.y() < 8);
+    assert(fromTimeLine >= 0 && fromTimeLine < MAX_TIMELINES && toTimeLine >= 0 && toTimeLine < MAX_TIMELINES);
+    assert(fromHalfTurn >= 0 && fromHalfTurn < MAX_HALF_TURNS && toHalfTurn >= 0 && toHalfTurn < MAX_HALF_TURNS);
+  }
 
-class IGame {
-public:
-  IGame(int N) : _N(N), _presentHalfTurn(0), _currentTurnColor(PieceColor::PIECEWHITE) {}
-  virtual ~IGame() = default;
+  inline Position2D from(void) const { return Position2D(_bits & 7, _bits >> 3 & 7); }
+  inline Position2D to(void) const { return Position2D(_bits >> 6 & 7, _bits >> 9 & 7); }
+  inline constexpr int fromTimeLine(void) const { return _bits >> 12 & (MAX_TIMELINES - 1); }
+  inline constexpr int toTimeLine(void) const { return _bits >> 22 & (MAX_TIMELINES - 1); }
+  inline constexpr int fromHalfTurn(void) const { return _bits >> 32 & (MAX_HALF_TURNS - 1); }
+  inline constexpr int toHalfTurn(void) const { return _bits >> 44 & (MAX_HALF_TURNS - 1); }
+  inline constexpr u8 flags(void) const { return _bits >> 56; }
+  inline constexpr bool hasFlag(Flag flag) const { return flags() & flag; }
 
   /**
-   * Get the dimension of the game.
-   * @return The dimension of the game as an integer.
-   * This method returns the size of the board (N).
+   * Get the raw encoding of the move.
+   * @return The 64 bits of the move, equal for equal moves, usable as a sort or hash key.
    */
-  inline int dim(void) const {
-    return _N;
-  }
+  inline constexpr u64 bits(void) const { return _bits; }
 
   /**
-   * Get the current full turn number.
-   * @return The current full turn number as an integer.
+   * Rebuild a move from its raw encoding.
+   * @param bits The value returned by bits().
+   * @return The move.
    */
-  inline int presentFullTurn(void) const {
+  static inline constexpr PackedMove fromBits(u64 bits) {
+    PackedMove move;
+    move._bits = bits;
+    return move;
+  }
+
+  inline constexpr bool operator==(const PackedMove& other) const = default;
+private:
+  u64 _bits;
+};
+static_assert(sizeof(PackedMove) == 8 and std::is_trivially_copyable_v<PackedMove>);
+
+/**
+ * A fixed-capacity list of packed moves, meant to be allocated once and reused.
+ * Pushing past the capacity drops the move and counts it, the generators report the dropped moves in their
+ * result. The capacity holds the moves of one board, positions with many boards can exceed it: searches
+ * generate one board at a time (IGame::generateMoves).
+ */
+class MoveBuffer {
+public:
+  static constexpr int CAPACITY = 4096;
+
+  MoveBuffer(void) : _size(0), _dropped(0) {}
+
+  inline void clear(void) {
+    _size = 0;
+    _dropped = 0;
+  }
+
+  inline void push(PackedMove move) {
+    if (_size < CAPACITY) {
+      _moves[_size++] = move;
+    } else {
+      _dropped += 1;
+    }
+  }
+
+  inline int size(void) const { return _size; }
+  inline bool empty(void) const { return _size == 0; }
+
+  /**
+   * Get the number of moves pushed since the last clear, including those that did not fit.
+   */
+  inline int pushed(void) const { return _size + _dropped; }
+
+  /**
+   * Check whether moves were dropped.
+   * @return True if more than CAPACITY moves were pushed since the last clear.
+   */
+  inline bool overflowed(void) const { return _dropped > 0; }
+
+  inline PackedMove operator[](int index) const {
+    assert(index >= 0 && index < _size);
+    return _moves[index];
+  }
+
+  inline const PackedMove* begin(void) const { return _moves.data(); }
+  inline const PackedMove* end(void) const { return _moves.data() + _size; }
+  inline PackedMove* begin(void) { return _moves.data(); }
+  inline PackedMove* end(void) { return _moves.data() + _size; }
+private:
+  std::array<PackedMove, CAPACITY> _moves;
+  int _size;
+  int _dropped;
+};
+
+class RuleEngine {
+public:
+  bool pawnCanMakeTwoMoveOnFirstTurn = true;
+};
+
+/**
+ * The memory held by a game, in bytes.
+ * Boards shared with a snapshot are counted by every game holding them.
+ */
+struct MemoryUsage {
+  std::size_t boards = 0; // the board objects, without their piece placement
+  std::size_t pieces = 0; // the piece placements of the boards
+  std::size_t timeLines = 0; // the timeline objects and their histories, deltas included
+  std::size_t other = 0; // the multiverse index, the per-turn stacks and the pools
+  std::size_t arena = 0; // the bytes handed out by the arena of the game so far, released objects included
+
+  /**
+   * Get the memory currently held by the game.
+   * @return The sum of every part but the arena, which overlaps them.
+   */
+  inline std::size_t total(void) const {
+    return boards + pieces + timeLines + other;
+  }
+};
+
+/**
+ * Which moves move generation returns.
+ * PSEUDO_LEGAL follows the movement rules of the pieces only, LEGAL additionally drops the moves after which
+ * the opponent could capture a king.
+ */
+enum class MoveFilter {
+  PSEUDO_LEGAL,
+  LEGAL
+};
+
+class IGame {
+public:
+  /**
+   * The maximum number of moves in a turn, every move consumes at least one moveable board.
+   */
+  static constexpr int MAX_TURN_MOVES = PackedMove::MAX_TIMELINES;
+
+  IGame(int N) : _N(N), _presentHalfTurn(0), _currentTurnColor(PieceColor::PIECEWHITE), _arena(std::make_shared<GameArena>()), _moveGenerator(_selectMoveGenerator(N)) {
+    // the move stacks only reallocate past MAX_TURN_MOVES moves, so doMove and undoMove stay allocation-free
+    _nextHalfTurnBuffer.reserve(MAX_TURN_MOVES);
+    _currentTurnMoves.reserve(MAX_TURN_MOVES);
+    _undoBuffer.reserve(MAX_TURN_MOVES);
+    _turnBuffer.reserve(MAX_TURN_MOVES);
+  }
+  virtual ~IGame() = default;
+  IGame& operator=(const IGame&) = delete;
+
+  /**
+   * Get the dimension of the game.
+   * @return The dimension of the game as an integer.
+   * This method returns the size of the board (N).
+   */
+  inline int dim(void) const {
+    return _N;
+  }
+
+  /**
+   * Get the current full turn number.
+   * @return The current full turn number as an integer.
+   */
+  inline int presentFullTurn(void) const {
     return _presentHalfTurn / 2;
   }
 
@@ -495,10 +1523,12 @@ public:
     return _presentHalfTurn;
   }
 
+  /**
+   * Get the half turn the present moves to once the current turn is submitted.
+   * @return The earliest half turn of the boards made this turn, or the present half turn if no move was made.
+   */
   inline int bufferHalfTurn(void) const {
-    return _currentTurnMoves.size() == 0
-          ? _presentHalfTurn
-          : *std::min_element(_nextHalfTurnBuffer.begin(), _nextHalfTurnBuffer.end());
+    return int(_nextHalfTurnBuffer.size()) == _turnStart ? _presentHalfTurn : _nextHalfTurnBuffer.back();
   }
 
   /**
@@ -509,6 +1539,27 @@ public:
    */
   void submitTurn(void);
 
+  /**
+   * Submit the current turn so that it can be taken back, for search.
+   * Same as submitTurn, but the moves of the turn are kept so that undoSubmit can restore it. It does not
+   * allocate while fewer than MAX_TURN_MOVES moves and turns are stacked.
+   */
+  void doSubmit(void);
+
+  /**
+   * Take back the last turn submitted with doSubmit, once every move made since was undone.
+   * The moves of that turn become the current turn again, undoMove takes them back one by one.
+   */
+  void undoSubmit(void);
+
+  /**
+   * Check whether a turn submitted with doSubmit can be taken back.
+   * @return True if a turn was submitted with doSubmit and no move was made since.
+   */
+  inline bool submitUndoable(void) const {
+    return not _turnBuffer.empty() and not undoable();
+  }
+
   /**
    * Get the board where the current player can make moves.
    * @return A vector of shared pointers to the boards where moves can be made.
@@ -517,15 +1568,171 @@ public:
    */
   std::vector<std::shared_ptr<Board>> getMoveableBoards(void) const;
 
+  /**
+   * Check whether a board can still be moved from this turn.
+   * @return True if the tip of some timeline is at the present half turn.
+   */
+  inline bool hasMoveableBoards(void) const {
+    return _moveableCount > 0;
+  }
+
+  /**
+   * Get the number of boards that can still be moved from this turn.
+   * @return The number of timelines whose tip is at the present half turn.
+   */
+  inline int moveableBoardCount(void) const {
+    return _moveableCount;
+  }
+
+  /**
+   * Check whether the tip of a timeline can be moved from.
+   * @param timeLineID The ID of the timeline.
+   * @return True if the tip of the timeline is at the present half turn.
+   */
+  inline bool isMoveable(int timeLineID) const {
+    return unsigned(timeLineID) < _moveable.size() * 64 and (_moveable[timeLineID / 64] >> (timeLineID % 64) & 1);
+  }
+
   /**
    * Get the positions where the current player can make moves.
    * @param selected The selected position to check for moveable positions.
+   * @param filter Whether moves leaving a king capturable are dropped.
    * @return A vector of SelectedPosition objects representing the moveable positions.
    * This method returns a vector of positions that are available for making moves based on the selected position.
    */
-  std::vector<SelectedPosition> getMoveablePositions(SelectedPosition selected) const;
+  std::vector<SelectedPosition> getMoveablePositions(SelectedPosition selected, MoveFilter filter = MoveFilter::LEGAL) const;
+
+  /**
+   * Get the positions where the current player can make moves, without allocating.
+   * @param selected The selected position to check for moveable positions.
+   * @param targets The buffer the destinations are written to.
+   * @param filter Whether moves leaving a king capturable are dropped.
+   * @return The number of destinations of the piece. Only the first targets.size() of them are written, so a
+   * result larger than the buffer means the caller should retry with a bigger one.
+   */
+  int getMoveablePositions(const SelectedPosition& selected, std::span<MoveTarget> targets, MoveFilter filter = MoveFilter::LEGAL) const;
+
+  /**
+   * Generate every move of the current player.
+   * @param moves The buffer the moves are appended to, it is not cleared first.
+   * @param filter Whether moves leaving a king capturable are dropped.
+   * @return The number of moves generated. Only the first ones fit when the buffer fills up, so a result larger
+   * than the moves appended means some were dropped and the list is incomplete, not that they are illegal.
+   * Every piece of the current player on every moveable board is visited once, through the piece masks of the
+   * boards, so no per-piece validation happens and nothing is thrown.
+   */
+  int generateAllMoves(MoveBuffer& moves, MoveFilter filter = MoveFilter::LEGAL) const;
+
+  /**
+   * Generate every move of the current player from one board.
+   * @param timeLineID The timeline whose tip is moved from, it must be a moveable board.
+   * @param moves The buffer the moves are appended to, it is not cleared first.
+   * @param filter Whether moves leaving a king capturable are dropped.
+   * @return The number of moves generated, larger than the moves appended if the buffer filled up.
+   */
+  int generateMoves(int timeLineID, MoveBuffer& moves, MoveFilter filter = MoveFilter::LEGAL) const;
+
+  /**
+   * Check whether a move is legal.
+   * @param move A pseudo-legal move of the current player.
+   * @return False if the opponent could capture a king once the move is made, on top of the moves already made
+   * this turn.
+   * Legality is decided by check and pin analysis along the 4D lines, without making the move.
+   */
+  bool isLegal(PackedMove move) const;
+
+  /**
+   * Check whether a piece could capture on a square.
+   * @param square The square as (x, y, full turn, timeline), its board is the one of that full turn the attacker moves on.
+   * @param attacker The color of the attacking pieces.
+   * @return True if a piece of the attacker, standing on the tip of a timeline where the attacker is to move,
+   * can reach the square with one move.
+   * Attacks from the board of the square come from Board::attacks, the others are found by walking the 4D
+   * movement tables backwards from the square, so the cost does not depend on the number of pieces.
+   */
+  bool isSquareAttacked(Vector4D square, PieceColor attacker) const;
+
+  /**
+   * Check whether a king is in check.
+   * @param color The color of the king.
+   * @return True if the opponent could capture a king of that color with one move from the current multiverse.
+   * Called after the moves of a turn were made, it tells whether submitting the turn would leave a king capturable.
+   */
+  bool isInCheck(PieceColor color) const;
 
-  void makeMove(Move move);
+  /**
+   * Get the position a move target refers to.
+   * @param target The move target.
+   * @return The SelectedPosition of the target square.
+   */
+  inline SelectedPosition toSelectedPosition(const MoveTarget& target) const {
+    return SelectedPosition(getBoard(target.timeLine, target.halfTurn), target.position());
+  }
+
+  inline void makeMove(Move move) {
+    doMove(pack(move));
+  }
+
+  /**
+   * Make a packed move.
+   * @param move The move to make, its coordinates must refer to boards of this game.
+   */
+  inline void makeMove(PackedMove move) {
+    doMove(move);
+  }
+
+  /**
+   * Make a move without allocating, for search.
+   * @param move A pseudo-legal move of the current player, its coordinates must refer to boards of this game.
+   * The new boards and timelines are taken from the pools refilled by undoMove and the undo record goes to a
+   * stack reserved with the game, so once the pools are warm no memory is allocated. This holds in SNAPSHOT
+   * history mode, DELTA mode rebuilds boards on demand.
+   * @throws std::length_error If the move would create a timeline past PackedMove::MAX_TIMELINES or a board past
+   * PackedMove::MAX_HALF_TURNS, which the generators never produce. The game is left unchanged.
+   */
+  void doMove(PackedMove move);
+
+  /**
+   * Take back the last move of the current turn.
+   * The boards and timelines the move created go back to the pools of the game, unless something else (e.g.
+   * the renderer) still holds a reference to them.
+   */
+  void undoMove(void);
+
+  /**
+   * Pack a move.
+   * @param move The move to pack, from the current player.
+   * @return The packed move, with its flags computed from the current state of the game.
+   */
+  PackedMove pack(const Move& move) const;
+
+  /**
+   * Pack a move given by its source square and a move target.
+   * @param from The selected piece.
+   * @param target One of the destinations generated for the piece.
+   * @return The packed move, with its flags computed from the current state of the game.
+   */
+  PackedMove pack(const SelectedPosition& from, const MoveTarget& target) const;
+
+  /**
+   * Unpack a move.
+   * @param move The packed move.
+   * @return The Move referring to the boards of this game.
+   */
+  inline Move unpack(PackedMove move) const {
+    return Move{
+      SelectedPosition(getBoard(move.fromTimeLine(), move.fromHalfTurn()), move.from()),
+      SelectedPosition(getBoard(move.toTimeLine(), move.toHalfTurn()), move.to())
+    };
+  }
+
+  /**
+   * Get the moves made so far in the current turn.
+   * @return The moves in the order they were made.
+   */
+  inline std::span<const PackedMove> currentTurnMoves(void) const {
+    return std::span<const PackedMove>(_currentTurnMoves).subspan(_turnStart);
+  }
 
   /**
    * Check if the current turn can be undone.
@@ -533,17 +1740,29 @@ public:
    * This method checks if there are any moves in the current turn that can be undone.
    */
   bool undoable(void) const {
-    return !_currentTurnMoves.empty();
+    return int(_currentTurnMoves.size()) > _turnStart;
   }
 
   bool canMakeMoveFromBoard(std::shared_ptr<Board> board) const;
 
-  bool boardExists(int timeLineID, int halfTurn) const;
+  inline bool boardExists(int timeLineID, int halfTurn) const {
+    return _index.exists(timeLineID, halfTurn);
+  }
 
   inline std::shared_ptr<Board> getBoard(int timeLineID, int halfTurn) const {
-    return _timeLines[timeLineID]->getBoardByHalfTurn(halfTurn);
+    Board* board = _boardAt(timeLineID, halfTurn);
+    assert(board != nullptr);
+    return board->shared_from_this();
   }
 
+  /**
+   * Change how timelines of the game store their history.
+   * @param mode The history mode applied to every current and future timeline.
+   * @param keyframeInterval In DELTA mode, the number of half turns between two keyframes.
+   * DELTA mode is meant for headless play and archiving, see TimeLine::setHistoryMode.
+   */
+  void setHistoryMode(HistoryMode mode, int keyframeInterval = TimeLine::DEFAULT_KEYFRAME_INTERVAL);
+
   inline bool gameEnd(void) const {
     return _gameWinner.has_value();
   }
@@ -553,37 +1772,735 @@ public:
     return *_gameWinner;
   }
 
+  /**
+   * Get the Zobrist hash of the whole game state.
+   * @return A key combining every board with its (timeline, half turn) coordinate, the color to move and
+   * the present half turn.
+   * The board part is updated incrementally whenever a board enters or leaves the multiverse.
+   */
+  inline u64 hash(void) const {
+    return _boardsHash
+      ^ (_currentTurnColor == PieceColor::PIECEBLACK ? Zobrist::BLACK_TO_MOVE_KEY : 0)
+      ^ Zobrist::presentKey(_presentHalfTurn);
+  }
+
+  /**
+   * Get the static score of the playable boards.
+   * @return The sum of Board::score over the tips of the timelines, white minus black.
+   * Updated incrementally whenever a board enters or leaves the multiverse, like the hash.
+   */
+  inline int tipsScore(void) const {
+    return _tipsScore;
+  }
+
+  /**
+   * Get the timeline advantage.
+   * @return The number of timelines created by white minus the number created by black.
+   */
+  inline int timeLineBalance(void) const {
+    return _timeLineBalance;
+  }
+
+  /**
+   * Fork the game into an independent copy.
+   * @return A game in the same state, moves of the current turn included, that can be played and undone
+   * without affecting this one, e.g. from a worker thread.
+   * Boards never change once in the multiverse, so the copy shares them and only copies the board lists of
+   * the timelines, the index and the per-turn state, at the cost of a reference count per board. Boards only
+   * know their timeline by ID (Board::timeLineID), the same in both games.
+   * The copy is a plain IGame, the variants only differ by their starting position.
+   */
+  std::shared_ptr<IGame> snapshot(void) const;
+
+  /**
+   * Get the memory held by the game.
+   * @return The bytes held by the boards, their pieces, the timelines and the bookkeeping of the game.
+   * Every board and timeline is owned by the game alone (boards point back to their timeline, and timelines to
+   * their parent, without owning them), so the whole multiverse is released with the game.
+   */
+  MemoryUsage memoryUsage(void) const;
+
   inline std::shared_ptr<Board> getNewBoard(void) const {
     assert(undoable());
-    return _timeLines[_undoBuffer.back().back()]->back();
+    const UndoRecord& record = _undoBuffer.back();
+    return _timeLines[record.toTimeLine >= 0 ? record.toTimeLine : record.move.fromTimeLine()]->back();
   }
 protected:
+  /**
+   * Copy a game, sharing its boards, see snapshot.
+   * @param other The game to copy, it is only read.
+   */
+  IGame(const IGame& other);
+
   int _N;
   int _presentHalfTurn;
-  std::vector<int> _nextHalfTurnBuffer;
+  // The per-move stacks below hold the moves of the current turn from _turnStart on, the moves before it belong
+  // to the turns submitted with doSubmit
+  int _turnStart = 0;
+  std::vector<int> _nextHalfTurnBuffer; // per move, the earliest half turn of the boards made so far in its turn
   std::vector<std::shared_ptr<TimeLine>> _timeLines;
-  std::vector<Move> _currentTurnMoves;
+  std::vector<PackedMove> _currentTurnMoves;
   PieceColor _currentTurnColor;
-  std::vector<std::vector<int>> _undoBuffer;
+
+  /**
+   * What undoSubmit needs to take a turn back.
+   */
+  struct TurnRecord {
+    int turnStart;
+    int presentHalfTurn;
+  };
+
+  std::vector<TurnRecord> _turnBuffer; // one record per turn submitted with doSubmit
+
+  /**
+   * What undoMove needs to take a move back.
+   */
+  struct UndoRecord {
+    PackedMove move;
+    int toTimeLine; // the timeline the piece arrived on, -1 if the move stayed on its board
+    bool endedGame; // the move captured a king and decided the winner
+  };
+
+  std::vector<UndoRecord> _undoBuffer; // one record per move, reserved up to MAX_TURN_MOVES
+  std::vector<std::shared_ptr<Board>> _boardPool; // boards released by undoMove, ready for reuse
+  std::vector<std::shared_ptr<TimeLine>> _timeLinePool; // empty timelines released by undoMove
   RuleEngine _rule;
   std::optional<PieceColor> _gameWinner;
+  std::shared_ptr<GameArena> _arena;
+  MultiverseIndex _index;
+  u64 _boardsHash = 0; // XOR of Zobrist::boardSlotKey over every board of the multiverse
+  std::vector<u64> _moveable; // a bit per timeline ID, set while the tip of the timeline is at the present half turn
+  int _moveableCount = 0;
+  int _tipsScore = 0; // sum of Board::score over the tips of the timelines
+  int _timeLineBalance = 0; // timelines created by white minus those created by black
+  // [color] the kings of that color on the boards the opponent moves from, in the order their boards were pushed
+  std::array<std::vector<Vector4D>, 2> _kings;
+
+  /**
+   * Record the half turn of the board a move made, keeping the earliest one of the turn at the back.
+   * @param halfTurn The half turn of the new board.
+   */
+  inline void _pushNextHalfTurn(int halfTurn) {
+    _nextHalfTurnBuffer.push_back(int(_nextHalfTurnBuffer.size()) == _turnStart ? halfTurn : std::min(_nextHalfTurnBuffer.back(), halfTurn));
+  }
+
+  /**
+   * Hand the move to the opponent, the present moving to the earliest board made this turn.
+   */
+  void _passTurn(void);
+
+  /**
+   * Update the moveable bit of a timeline after its tip or the present changed.
+   * @param timeLineID The ID of the timeline, it may have just been removed.
+   */
+  inline void _updateMoveable(int timeLineID) {
+    u64 bit = u64(1) << (timeLineID % 64);
+    bool moveable = timeLineID < int(_timeLines.size()) and _timeLines[timeLineID]->halfTurnNumber() == _presentHalfTurn;
+    u64& word = _moveable[timeLineID / 64];
+    _moveableCount += int(moveable) - int(bool(word & bit));
+    word = moveable ? word | bit : word & ~bit;
+  }
+
+  // Counts move targets and writes those that fit into a buffer, or packs them straight into a MoveBuffer
+  struct _MoveTargetWriter {
+    std::span<MoveTarget> targets;
+    int count = 0;
+    MoveBuffer* moves = nullptr; // when set, targets is unused
+    const IGame* game = nullptr;
+    int fromTimeLine = 0; // the coordinate and code of the piece, when packing
+    int fromHalfTurn = 0;
+    Position2D from = Position2D(-1, -1);
+    PieceCode piece = EMPTY_SQUARE;
+    bool legalOnly = false; // drop the moves rejected by _isLegal
+    bool nearLimits = false; // drop the moves rejected by _exceedsPackedLimits, see _nearPackedLimits
+
+    inline void push(int timeLine, int halfTurn, int x, int y) {
+      if (nearLimits and game->_exceedsPackedLimits(fromHalfTurn, timeLine, halfTurn)) {
+        return;
+      }
+      if (legalOnly and not game->_isLegal(fromTimeLine, fromHalfTurn, from, piece, timeLine, halfTurn, Position2D(x, y))) {
+        return;
+      }
+      if (moves != nullptr) {
+        Position2D to(x, y);
+        moves->push(PackedMove(fromTimeLine, fromHalfTurn, from, timeLine, halfTurn, to,
+                               game->_moveFlags(piece, fromTimeLine, fromHalfTurn, timeLine, halfTurn, to)));
+      } else if (count < int(targets.size())) {
+        targets[count] = MoveTarget{u16(timeLine), u16(halfTurn), u8(x), u8(y)};
+      }
+      count += 1;
+    }
+  };
+
+  /**
+   * Compute the flags of a move.
+   * @param piece The code of the moving piece.
+   * @param fromTimeLine The timeline of the source board.
+   * @param fromHalfTurn The half turn of the source board.
+   * @param toTimeLine The timeline of the target board.
+   * @param toHalfTurn The half turn of the target board.
+   * @param to The target square.
+   * @return The PackedMove::Flag bits describing the move.
+   */
+  u8 _moveFlags(PieceCode piece, int fromTimeLine, int fromHalfTurn, int toTimeLine, int toHalfTurn, Position2D to) const;
+
+  using MoveGenerator = void (IGame::*)(const Board& board, Vector4D from, PieceCode piece, _MoveTargetWriter& writer) const;
+
+  MoveGenerator _moveGenerator; // move generation kernel specialized for the board size of the game, chosen once at construction
+
+  /**
+   * Get the move generation kernel for a board size.
+   * @param N The size of the boards.
+   * @return A pointer to _generateMoves instantiated for N.
+   */
+  static MoveGenerator _selectMoveGenerator(int N);
+
+  /**
+   * Generate the moves of a piece.
+   * @tparam N The size of the boards, known at compile time so that edge checks fold and rays unroll.
+   * @param board The board of the piece.
+   * @param from The coordinate of the piece.
+   * @param piece The code of the piece.
+   * @param writer The writer the destinations are pushed to.
+   */
+  template<int N>
+  void _generateMoves(const Board& board, Vector4D from, PieceCode piece, _MoveTargetWriter& writer) const;
+
+  /**
+   * Generate the moves of every piece of the current player on the tip of a timeline.
+   * @param timeLine The timeline, its tip must be at the present half turn.
+   * @param writer The writer the moves are packed into.
+   */
+  void _generateBoardMoves(const TimeLine& timeLine, _MoveTargetWriter& writer) const;
+
+  // A board a move would add to the multiverse, tested in place without making the move
+  struct _VirtualBoard {
+    int timeLine = -1;
+    int halfTurn = -1;
+    const Board* board = nullptr;
+  };
+  using _Overlay = std::array<_VirtualBoard, 2>; // unused entries hold no board
+
+  // What a move must satisfy so that no king is left capturable, summarized for every move sharing a board
+  struct _MoveConstraints {
+    bool exact = false; // the moves could not be summarized and are tested one by one
+    bool impossible = false; // no move satisfies the constraints
+    u64 requiredTo = ~u64(0); // the target square must be one of these
+    u64 forbiddenFrom = 0; // the source square must not be one of these
+    // lines needing both conditions, a move is rejected when its source is in from and its target is not in to
+    struct Clause {
+      u64 from;
+      u64 to;
+    };
+    std::array<Clause, 4> clauses;
+    int clauseCount = 0;
+  };
+
+  struct _KingSafety {
+    int square;
+    u64 checkMask; // the squares stopping the checks on the board
+    u64 danger; // the squares the king cannot step to on the board
+    bool attackedAway; // attacked from another board, which no move on this board changes
+  };
+
+  // A range of _LegalityCache::exposed
+  struct _KingRange {
+    int begin = 0;
+    int end = 0;
+  };
+
+  struct _SourceContext {
+    bool ready = false;
+    _KingRange exposed; // the kings a piece on the board could reach and no piece on a tip could, blockers aside
+    _MoveConstraints onBoard; // moves of pieces other than the king staying on the board, besides pins
+    _MoveConstraints away; // moves of pieces other than the king leaving the board
+    _MoveConstraints others; // the part of onBoard kept by the kings on other boards, for king moves
+    std::vector<_KingSafety> kings; // the kings of the player to move on the board
+    u64 pinned; // pieces pinned to their king on the board
+    std::array<u64, 64> pinLine; // the squares a pinned piece may still move to
+  };
+
+  struct _TargetContext {
+    _MoveConstraints constraints;
+    _KingRange exposed; // as for _SourceContext, with the board the move arrives on
+  };
+
+  // The constraints of a move between two boards, those of the target board included
+  struct _PairContext {
+    _MoveConstraints constraints;
+    _MoveConstraints targetKings; // the part of constraints kept by the target board and its kings, for king moves
+  };
+
+  /**
+   * An open addressing table of the contexts of one position, emptied in constant time by moving to the next stamp.
+   * Its slots are kept from one position to the next, so that lookups neither allocate nor chase pointers.
+   */
+  template<class Context>
+  struct _ContextTable {
+    struct Slot {
+      u64 key = 0;
+      u32 stamp = 0; // the slot is used when it holds the stamp of the table
+      Context context;
+    };
+    std::vector<Slot> slots; // a power of two, at most half of them used
+    u32 stamp = 1;
+    int count = 0;
+
+    inline void clear(void) {
+      count = 0;
+      if (++stamp == 0) {
+        // the stamps wrapped around, the slots of the first positions must not look used
+        for (Slot& slot : slots) slot.stamp = 0;
+        stamp = 1;
+      }
+    }
+
+    /**
+     * Find the context of a key.
+     * @return The context, nullptr if there is none.
+     */
+    inline Context* find(u64 key) {
+      std::size_t mask = slots.size() - 1;
+      for (std::size_t index = _home(key); not slots.empty() and slots[index].stamp == stamp; index = (index + 1) & mask) {
+        if (slots[index].key == key) return &slots[index].context;
+      }
+      return nullptr;
+    }
+
+    /**
+     * Add the context of a key that is not in the table.
+     * @return The context added, valid until the next insert.
+     */
+    Context& insert(u64 key, const Context& context) {
+      if (2 * (count + 1) > int(slots.size())) {
+        std::vector<Slot> old(std::max<std::size_t>(2 * slots.size(), 64));
+        old.swap(slots);
+        count = 0;
+        for (const Slot& slot : old) {
+          if (slot.stamp == stamp) insert(slot.key, slot.context);
+        }
+      }
+      std::size_t mask = slots.size() - 1, index = _home(key);
+      while (slots[index].stamp == stamp) {
+        index = (index + 1) & mask;
+      }
+      count += 1;
+      slots[index].key = key;
+      slots[index].stamp = stamp;
+      slots[index].context = context;
+      return slots[index].context;
+    }
+
+    inline std::size_t _home(u64 key) const {
+      return Zobrist::mix(key) & (slots.size() - 1);
+    }
+  };
+
+  // Legality analysis of the current position, reused by every move generated from it
+  struct _LegalityCache {
+    bool valid = false;
+    u64 key = 0; // hash() of the position analyzed
+    bool inCheck = false; // a king is already capturable, no move can change that
+    std::vector<bool> threatened; // per king of the player to move, whether a piece on a tip could reach it, blockers aside
+    std::vector<int> threats; // the indices of the kings threatened
+    std::vector<int> exposed; // indices of kings, the ranges of the contexts of the position
+    std::vector<_SourceContext> sources; // indexed by timeline, entries past the timeline count are stale
+    _ContextTable<_TargetContext> targets; // keyed by _contextKey of the target board
+    _ContextTable<_PairContext> pairs; // keyed by _contextKey of the source timeline and target board
+  };
+
+  /**
+   * Get the key of a context in the legality cache.
+   * @return The arguments packed into one integer.
+   */
+  static inline u64 _contextKey(int fromTimeLineID, int toTimeLineID, int toHalfTurn) {
+    return u64(fromTimeLineID) << 40 | u64(toTimeLineID) << 20 | u64(toHalfTurn);
+  }
+
+  mutable _LegalityCache _legality; // only touched from the thread that owns the game
+
+  /**
+   * Analyze the current position for legality checks, unless it already was.
+   * @return The analysis of the current position.
+   */
+  const _LegalityCache& _prepareLegality(void) const;
+
+  /**
+   * Check whether _constrainKing can find a line to a king of the player to move, from a tip or a board of an overlay.
+   * @param index The index of the king in the kings of the player to move.
+   */
+  bool _mayBeAttacked(std::size_t index, const _Overlay& overlay) const;
+
+  /**
+   * List the kings of the player to move that a piece on a board a move adds could reach and no piece on a tip could,
+   * blockers aside. The other kings are out of reach of any line through the board.
+   * @return Their range in _legality.exposed.
+   */
+  _KingRange _exposeKings(const _VirtualBoard& added) const;
+
+  /**
+   * Call a function with the index of each king of the player to move in reach of a tip or of the boards of two ranges
+   * given by _exposeKings, so that the kings no line can reach are skipped.
+   * @param visit Called once per king, returns false to stop.
+   */
+  template<class Visit>
+  void _visitKingsInReach(_KingRange first, _KingRange second, Visit visit) const;
+
+  /**
+   * Check whether a pseudo-legal move of the current player is legal, see isLegal.
+   * _prepareLegality must have been called since the position last changed.
+   */
+  bool _isLegal(int fromTimeLine, int fromHalfTurn, Position2D from, PieceCode piece, int toTimeLine, int toHalfTurn, Position2D to) const;
+
+  /**
+   * Check whether a move leaves a king capturable by building its boards aside and testing every king.
+   * Used for the moves the summarized constraints cannot decide, such as king moves.
+   */
+  bool _leavesKingCapturable(int fromTimeLine, int fromHalfTurn, Position2D from, PieceCode piece, int toTimeLine, int toHalfTurn, Position2D to) const;
+
+  enum class _LineFilter {
+    ALL, // every line
+    PIVOT, // the lines touching the pivot board
+    OVERLAY, // the lines touching both boards of the overlay, the first one vacated and the second one filled
+  };
+
+  /**
+   * Restrict a move so that no line from a king to a board the attacker moves from is left attacked.
+   * @param king The square of the king as (x, y, full turn, timeline).
+   * @param attacker The color of the attacking pieces.
+   * @param overlay The boards the move adds, they are boards the attacker moves from.
+   * @param pivot The index in overlay of the board whose squares depend on the move, or -1.
+   * @param canFill Whether the move places a piece on the pivot board.
+   * @param canVacate Whether the move takes a piece off the pivot board.
+   * @param filter The lines to consider.
+   * @param constraints The constraints the lines are folded into, impossible is set by a line attacked outright.
+   * Attacks from the board of the king itself are left to the caller.
+   */
+  void _constrainKing(Vector4D king, PieceColor attacker, const _Overlay& overlay, int pivot, bool canFill, bool canVacate,
+                      _LineFilter filter, _MoveConstraints& constraints) const;
+
+  /**
+   * Get the analysis of the moves leaving the tip of a timeline, made on first use in the position.
+   */
+  inline const _SourceContext& _sourceContext(int timeLineID) const {
+    const _SourceContext& context = _legality.sources[timeLineID];
+    return context.ready ? context : _analyzeSource(timeLineID);
+  }
+
+  /**
+   * Get the analysis of the moves from the tip of a timeline to a board, made on first use in the position.
+   */
+  inline const _PairContext& _pairContext(int fromTimeLineID, int toTimeLineID, int toHalfTurn) const {
+    const _PairContext* context = _legality.pairs.find(_contextKey(fromTimeLineID, toTimeLineID, toHalfTurn));
+    return context != nullptr ? *context : _analyzePair(fromTimeLineID, toTimeLineID, toHalfTurn);
+  }
+
+  const _SourceContext& _analyzeSource(int timeLineID) const;
+  const _TargetContext& _targetContext(int timeLineID, int halfTurn) const;
+  const _PairContext& _analyzePair(int fromTimeLineID, int toTimeLineID, int toHalfTurn) const;
+
+  HistoryMode _historyMode = HistoryMode::SNAPSHOT;
+  int _keyframeInterval = TimeLine::DEFAULT_KEYFRAME_INTERVAL;
+
+  /**
+   * Get the board at a coordinate of the multiverse.
+   * @param timeLineID The ID of the timeline.
+   * @param halfTurn The half turn of the board.
+   * @return A pointer to the board, or nullptr if there is no board at the coordinate.
+   * Boards that are only stored as deltas are rebuilt by their timeline, the pointer stays valid until
+   * the next board of that timeline is rebuilt.
+   */
+  inline Board* _boardAt(int timeLineID, int halfTurn) const {
+    Board* board = _index.at(timeLineID, halfTurn);
+    if (board != nullptr or not _index.exists(timeLineID, halfTurn)) {
+      return board;
+    }
+    return _timeLines[timeLineID]->getBoardByHalfTurn(halfTurn).get();
+  }
+
+  /**
+   * Get a board that stays valid while other boards are looked up.
+   * @param holder Keeps a board rebuilt from deltas alive, resident boards are returned without touching it.
+   */
+  inline const Board* _holdBoardAt(int timeLineID, int halfTurn, std::shared_ptr<Board>& holder) const {
+    if (const Board* board = _index.at(timeLineID, halfTurn)) {
+      return board;
+    }
+    holder = _timeLines[timeLineID]->getBoardByHalfTurn(halfTurn);
+    return holder.get();
+  }
+
+  /**
+   * Check whether a color moves next from a board.
+   * @param timeLineID The ID of the timeline of the board.
+   * @param halfTurn The half turn of the board.
+   * @param color The color to check.
+   * @return True if the board is the tip of its timeline and its half turn belongs to the color.
+   */
+  inline bool _isTipOf(int timeLineID, int halfTurn, PieceColor color) const {
+    return halfTurn % 2 == int(color) and _timeLines[timeLineID]->halfTurnNumber() == halfTurn;
+  }
+
+  /**
+   * Check whether a move would make a board PackedMove cannot address, on a timeline past MAX_TIMELINES or at a half
+   * turn past MAX_HALF_TURNS. Such moves are never generated and doMove refuses them.
+   * @param fromHalfTurn The half turn of the source board.
+   * @param toTimeLine The timeline of the target board.
+   * @param toHalfTurn The half turn of the target board.
+   */
+  inline bool _exceedsPackedLimits(int fromHalfTurn, int toTimeLine, int toHalfTurn) const {
+    return fromHalfTurn + 1 >= PackedMove::MAX_HALF_TURNS or toHalfTurn + 1 >= PackedMove::MAX_HALF_TURNS
+        or (int(_timeLines.size()) >= PackedMove::MAX_TIMELINES and _timeLines[toTimeLine]->halfTurnNumber() != toHalfTurn);
+  }
+
+  /**
+   * Check whether some move of the position may exceed the limits of PackedMove, so that the generators only check
+   * each move with _exceedsPackedLimits when it does.
+   */
+  bool _nearPackedLimits(void) const;
+
+  /**
+   * Create a timeline in the arena of the game.
+   * @param ID The ID of the timeline.
+   * @param forkAt The half turn the timeline forks at, -1 for a root timeline.
+   * @return A shared pointer to the new timeline.
+   */
+  std::shared_ptr<TimeLine> _makeTimeLine(int ID, int forkAt = -1) const;
+
+  /**
+   * Create an empty board in the arena of the game.
+   * @param timeLine The timeline the board belongs to.
+   * @param halfTurnNumber The half turn number of the board.
+   * @return A shared pointer to the new board.
+   */
+  std::shared_ptr<Board> _makeBoard(std::shared_ptr<TimeLine> timeLine, int halfTurnNumber = 0) const;
 
-  std::shared_ptr<Piece> _getPieceByVector4DFullTurn(Vector4D position) const;
   inline void _pushBack(std::shared_ptr<TimeLine> timeLine) {
+    assert(timeLine->ID() == int(_timeLines.size()) and timeLine->ID() < PackedMove::MAX_TIMELINES);
     _timeLines.push_back(timeLine);
+    _index.addTimeLine();
+    if (_moveable.size() * 64 < _timeLines.size()) {
+      _moveable.push_back(0);
+    }
   }
+
+  /**
+   * Append a board to a timeline and register it in the multiverse index.
+   * @param timeLineID The ID of the timeline.
+   * @param board The board to append.
+   * Every board of the game must be added through this method (or removed through _popBoard).
+   */
+  void _pushBoard(int timeLineID, std::shared_ptr<Board> board);
+
+  /**
+   * Remove the last board of a timeline, dropping the timeline itself once it is empty.
+   * @param timeLineID The ID of the timeline.
+   */
+  void _popBoard(int timeLineID);
+
+  /**
+   * Create the fork of a board, reusing a board of the pool if there is one.
+   * @param parent The board to fork.
+   * @param timeLine The timeline the new board belongs to.
+   * @return The new board, one half turn after its parent, not yet added to the timeline.
+   */
+  std::shared_ptr<Board> _forkBoard(const Board& parent, const std::shared_ptr<TimeLine>& timeLine);
+
+  /**
+   * Create a timeline branching off a board, reusing a timeline of the pool if there is one.
+   * @param parentID The ID of the timeline of the board.
+   * @param forkAt The half turn of the board.
+   * @return The new empty timeline, its ID is the next free one.
+   */
+  std::shared_ptr<TimeLine> _forkTimeLine(int parentID, int forkAt);
+
+  /**
+   * Remove the last board of a timeline and hand it, and the timeline if it became empty, back to the pools.
+   * @param timeLineID The ID of the timeline.
+   */
+  void _recycleTip(int timeLineID);
 public:
   inline std::vector<std::shared_ptr<TimeLine>> getTimeLines(void) const {
     return _timeLines;
   }
 
-  void undo(void);
+  inline int timeLineCount(void) const {
+    return int(_timeLines.size());
+  }
+
+  /**
+   * Get the last board of a timeline.
+   * @param timeLineID The ID of the timeline.
+   * @return The tip of the timeline, read without copying the timeline list or touching reference counts.
+   */
+  inline const Board& tipBoard(int timeLineID) const {
+    return *_boardAt(timeLineID, _timeLines[timeLineID]->halfTurnNumber());
+  }
+
+  /**
+   * Get a board without touching its reference count.
+   * @param timeLineID The ID of the timeline.
+   * @param halfTurn The half turn of the board.
+   * @return The board, nullptr if there is none. In DELTA mode a board rebuilt from deltas is only valid until the
+   * next board of its timeline is rebuilt, read it right away.
+   */
+  inline const Board* peekBoard(int timeLineID, int halfTurn) const {
+    return _boardAt(timeLineID, halfTurn);
+  }
+
+  inline void undo(void) {
+    undoMove();
+  }
 
   inline PieceColor getCurrentTurnColor(void) const {
     return _currentTurnColor;
   }
 };
 
+/**
+ * Check whether a move settles a moveable board, by leaving it or by arriving on it.
+ * @param game The game the move was generated on.
+ * @param move A move of the player to move.
+ * @param timeLineID The timeline of the board.
+ * @return True if the board is no longer moveable once the move is made.
+ */
+inline bool settles(const IGame& game, PackedMove move, int timeLineID) {
+  return move.fromTimeLine() == timeLineID
+    or (move.toTimeLine() == timeLineID and move.toHalfTurn() == game.presentHalfTurn() and not move.hasFlag(PackedMove::BRANCHING));
+}
+
+/**
+ * Choose the board a search over turns settles next: the one with the fewest LEGAL moves settling it.
+ *
+ * Checks only accumulate during a turn: a move adds boards to the multiverse and never changes one, so a
+ * move that leaves a king capturable cannot be fixed by the moves after it. A search can therefore make only
+ * the moves of the LEGAL filter, and give up on a partial turn as soon as a board that is left has no move
+ * and no piece can arrive on it. Settling the board with the fewest options first finds that out early.
+ * @param game The game.
+ * @param moves The LEGAL moves of the boards left, all of them: a truncated list would make a board look stuck.
+ * @param boards The timelines of the moveable boards left, ties go to the first one.
+ * @param options Scratch space, indexed by timeline ID, so that the choice does not allocate once it is large enough.
+ * @return The timeline of the board to settle, -1 if one of the boards has no move settling it.
+ */
+int choosePivot(const IGame& game, std::span<const PackedMove> moves, std::span<const int> boards, std::vector<int>& options);
+
+/**
+ * Searches the turns of the player to move.
+ * A turn settles every moveable board: each one is either moved from or receives a piece from another
+ * moveable board. It is legal if the opponent could not capture a king once it is submitted, so the player
+ * whose position has no legal turn has lost.
+ *
+ * The search makes only the moves of the LEGAL filter and settles the boards in the order of choosePivot,
+ * giving up on a partial turn as soon as a board that is left cannot be settled.
+ * Boards whose moves never land on a common timeline are split into groups that are solved apart, and their
+ * turns are only searched together when putting them side by side leaves a king capturable.
+ * Partial turns without a legal completion are cached by the Zobrist hash of the game.
+ *
+ * The moves of a turn are tried in one order: the search settles the board with the fewest moves first, and
+ * a move is judged where it lands at that point. A move creating a timeline is not retried with the ID it
+ * would get later in the turn, and a move landing on the tip of a timeline is not retried as a move creating
+ * a timeline once that tip has moved on.
+ */
+class TurnSolver {
+public:
+  static constexpr std::size_t DEFAULT_CACHE_SIZE = 1 << 16;
+  static constexpr u64 DIVE_BUDGET = 4; // nodes per board a greedy dive may visit before the full search takes over
+
+  /**
+   * Construct a solver for a game.
+   * @param game The game, moves are made and undone on it during a search and it is left as it was found.
+   * @param cacheSize The number of refuted partial turns kept, the cache is emptied when it fills up.
+   */
+  explicit TurnSolver(IGame& game, std::size_t cacheSize = DEFAULT_CACHE_SIZE);
+
+  /**
+   * Check whether the player to move has a legal turn.
+   * @param turn When not null, receives the moves of one legal turn.
+   * @return True if a legal turn exists from the current state, on top of the moves already made this turn.
+   */
+  bool hasLegalTurn(std::vector<PackedMove>* turn = nullptr);
+
+  /**
+   * Visit the legal turns of the player to move.
+   * @param visit Called with the moves of each legal turn while they are made on the game, returning false stops
+   * the enumeration. It must leave the game as it finds it.
+   * @param limit The maximum number of turns visited.
+   * @return The number of turns visited.
+   */
+  u64 forEachLegalTurn(const std::function<bool(const std::vector<PackedMove>&)>& visit, u64 limit = UINT64_MAX);
+
+  /**
+   * Get the number of partial turns searched since the solver was created.
+   * @return The number of search nodes.
+   */
+  inline u64 nodes(void) const {
+    return _nodes;
+  }
+
+  inline void clearCache(void) {
+    _refuted.clear();
+  }
+private:
+  IGame& _game;
+  std::size_t _cacheSize;
+  std::unordered_set<u64> _refuted; // hash of the game XOR the key of the boards left, for partial turns without completion
+  std::vector<std::vector<int>> _landings; // indexed by timeline ID, the other timelines a moveable board can land on the tip of
+  std::vector<std::vector<int>> _remaining; // the boards left at each depth of the search
+  std::vector<PackedMove> _moves; // the legal moves of each depth of the search, stacked
+  std::vector<int> _options; // scratch space of choosePivot
+  std::vector<PackedMove> _path;
+  std::vector<PackedMove> _solution;
+  MoveBuffer _buffer;
+  const std::function<bool(const std::vector<PackedMove>&)>* _visit = nullptr;
+  u64 _limit = 0;
+  u64 _visited = 0;
+  u64 _nodes = 0;
+  u64 _budget = 0; // the node count a dive gives up at
+
+  /**
+   * Collect where the pseudo-legal moves of every moveable board land into _landings.
+   * @return The IDs of the moveable boards.
+   */
+  std::vector<int> _prepare(void);
+
+  /**
+   * Split the moveable boards into groups whose moves never land on a common timeline.
+   * @param moveable The IDs of the moveable boards.
+   * @return The groups, each sorted by timeline ID.
+   */
+  std::vector<std::vector<int>> _groups(const std::vector<int>& moveable) const;
+
+  /**
+   * Search the completions of the current partial turn.
+   * @param depth The depth of the search, _remaining[depth] holds the boards left.
+   * @param key The key of the boards searched, XORed into the hash of the game for the cache.
+   * @return True if a legal completion was found. In enumeration mode every completion is visited first.
+   */
+  bool _search(int depth, u64 key);
+
+  /**
+   * Look for a turn greedily, settling the boards left in order with their own moves only.
+   * @param depth The depth of the dive, _remaining[depth] holds the boards left.
+   * @return True if a legal turn was found before the node budget ran out.
+   */
+  bool _dive(int depth);
+
+  /**
+   * Search the turns of a group of boards, leaving the other boards alone.
+   * @param group The IDs of the boards.
+   * @param turn Receives the moves of the first legal turn found.
+   * @return True if the group has a legal turn.
+   */
+  bool _solveGroup(const std::vector<int>& group, std::vector<PackedMove>& turn);
+
+  /**
+   * Make the turns of several groups one after another.
+   * @param turns The turns, made in order and undone before returning.
+   * @return The index of the first turn with a move leaving a king capturable, or -1 if all of them are legal together.
+   */
+  int _conflict(const std::vector<const std::vector<PackedMove>*>& turns);
+};
+
 class Constant {
 public:
   static const int BOARD_SIZE;
@@ -0,0 +1,277 @@
+#include "Engine/AlphaBetaEngine.h"
+#include <cstdlib>
+
+namespace Chess {
+
+static constexpr int INFINITE_SCORE = MATE_SCORE + 1;
+static constexpr int NO_TURN = -INFINITE_SCORE - 1; // below any score, a partial turn without legal completion
+
+static constexpr int HASH_MOVE_ORDER = 1 << 30;
+static constexpr int CAPTURE_ORDER = 1 << 28;
+static constexpr int PROMOTION_ORDER = 1 << 27;
+static constexpr int KILLER_ORDER = 1 << 26;
+static constexpr int HISTORY_LIMIT = 1 << 20;
+
+/**
+ * Mate scores are stored relative to the node, so that a mate found through another path keeps its distance.
+ */
+static int toTable(int score, int turnPly) {
+  return score > MATE_BOUND ? score + turnPly : score < -MATE_BOUND ? score - turnPly : score;
+}
+
+static int fromTable(int score, int turnPly) {
+  return score > MATE_BOUND ? score - turnPly : score < -MATE_BOUND ? score + turnPly : score;
+}
+
+AlphaBetaEngine::AlphaBetaEngine(int threads, std::size_t hashMegabytes) : _table(hashMegabytes) {
+  setThreads(threads);
+}
+
+AlphaBetaEngine::~AlphaBetaEngine(void) = default;
+
+void AlphaBetaEngine::setThreads(int threads) {
+  assert(threads > 0);
+  _pool.resize(threads);
+  while (int(_workers.size()) > threads) {
+    _workers.pop_back();
+  }
+  while (int(_workers.size()) < threads) {
+    _workers.push_back(std::make_unique<_Worker>(*this, int(_workers.size())));
+  }
+}
+
+void AlphaBetaEngine::clear(void) {
+  _table.clear();
+  for (std::unique_ptr<_Worker>& worker : _workers) {
+    for (_Ply& node : worker->plies) {
+      node.killers.fill(PackedMove());
+    }
+    worker->history = {};
+  }
+}
+
+SearchResult AlphaBetaEngine::findBestTurn(const IGame& game, const SearchLimits& limits) {
+  _start = std::chrono::steady_clock::now();
+  _limits = limits;
+  _stop.store(false, std::memory_order_relaxed);
+  _nodes.store(0, std::memory_order_relaxed);
+  _table.newSearch();
+
+  _pool.run([this, &game](int index) {
+    _workers[index]->run(game);
+    if (index == 0) {
+      // the helpers only feed the table, they stop with the main thread
+      _stop.store(true, std::memory_order_relaxed);
+    }
+  });
+  _Worker& main = *_workers[0];
+
+  SearchResult result = main.result;
+  result.nodes = 0;
+  for (std::unique_ptr<_Worker>& worker : _workers) {
+    result.nodes += worker->nodes;
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+  return result;
+}
+
+void AlphaBetaEngine::_Worker::run(const IGame& root) {
+  // the snapshot is taken by the thread itself, the root is only read
+  game = root.snapshot();
+  aborted = false;
+  nodes = 0;
+  unreported = 0;
+  rootMade = game->currentTurnMoves().size();
+  result = SearchResult();
+
+  const SearchLimits& limits = engine._limits;
+  if (not game->gameEnd() and game->hasMoveableBoards()) {
+    int maxDepth = limits.depth > 0 ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
+    // half of the helpers search one turn ahead, so that the threads do not all wait on the same subtrees
+    for (int depth = 1 + ID % 2; depth <= maxDepth; depth += 1) {
+      rootTurn.clear();
+      rootScore = NO_TURN;
+      int score = searchTurn(depth, -INFINITE_SCORE, INFINITE_SCORE, 0, 0);
+      if (aborted) {
+        // a partial iteration only searched some turns, it is trusted when nothing better is known
+        if (result.turn.empty() and not rootTurn.empty()) {
+          result.turn = rootTurn;
+          result.score = rootScore;
+        }
+        break;
+      }
+      result.turn = rootTurn;
+      result.score = score;
+      result.depth = depth;
+      if (rootTurn.empty() or std::abs(score) > MATE_BOUND) {
+        break;
+      }
+      // the next iteration takes several times longer, do not start what cannot be finished
+      if (ID == 0 and limits.time.count() > 0 and (std::chrono::steady_clock::now() - engine._start) * 2 > limits.time) {
+        break;
+      }
+    }
+  }
+  game.reset();
+}
+
+void AlphaBetaEngine::_Worker::checkLimits(void) {
+  u64 total = engine._nodes.fetch_add(unreported, std::memory_order_relaxed) + unreported;
+  unreported = 0;
+  const SearchLimits& limits = engine._limits;
+  aborted = aborted
+    or engine._stop.load(std::memory_order_relaxed)
+    or (limits.nodes > 0 and total >= limits.nodes)
+    or (limits.time.count() > 0 and std::chrono::steady_clock::now() >= engine._start + limits.time);
+}
+
+int AlphaBetaEngine::_Worker::searchTurn(int depth, int alpha, int beta, int turnPly, int ply) {
+  if (depth == 0) {
+    return engine._evaluator.evaluate(*game);
+  }
+  int score = searchMoves(depth, alpha, beta, turnPly, ply);
+  if (score == NO_TURN and not aborted) {
+    // without a legal turn the player is mated, or stalemated when not in check
+    return game->isInCheck(game->getCurrentTurnColor()) ? -MATE_SCORE + turnPly : 0;
+  }
+  return score;
+}
+
+int AlphaBetaEngine::_Worker::searchMoves(int depth, int alpha, int beta, int turnPly, int ply) {
+  if (aborted) {
+    return 0;
+  }
+
+  u64 key = game->hash();
+  TranspositionTable::Entry entry;
+  PackedMove hashMove;
+  if (engine._table.probe(key, entry)) {
+    hashMove = entry.move;
+    // the root turn is always searched, it has to record its best turn
+    if (turnPly > 0 and entry.depth >= depth) {
+      int score = fromTable(entry.score, turnPly);
+      if ((entry.bound & TranspositionTable::LOWER and score >= beta)
+          or (entry.bound & TranspositionTable::UPPER and score <= alpha)) {
+        return score;
+      }
+    }
+  }
+
+  _Ply& node = plyAt(ply);
+  bool complete = generateTurnMoves(*game, node.moves, boards, buffer);
+  int pivot = choosePivot(*game, node.moves, boards, options);
+  if (pivot < 0 and complete) {
+    return NO_TURN;
+  }
+
+  node.order.clear();
+  node.scores.clear();
+  for (int i = 0; pivot >= 0 and i < int(node.moves.size()); i += 1) {
+    PackedMove move = node.moves[i];
+    if (settles(*game, move, pivot)) {
+      node.order.push_back(i);
+      node.scores.push_back(orderScore(move, hashMove, node));
+    }
+  }
+  int count = int(node.order.size());
+
+  // once a turn is started, its later boards only get a few tries
+  bool narrow = game->undoable();
+  PieceColor color = game->getCurrentTurnColor();
+  int originalAlpha = alpha;
+  int best = NO_TURN;
+  int completed = 0;
+  PackedMove bestMove;
+  for (int i = 0; i < count; i += 1) {
+    // selection sort, a cutoff often comes before the end of the list
+    int next = i;
+    for (int j = i + 1; j < count; j += 1) {
+      if (node.scores[j] > node.scores[next]) {
+        next = j;
+      }
+    }
+    std::swap(node.order[i], node.order[next]);
+    std::swap(node.scores[i], node.scores[next]);
+    PackedMove move = node.moves[node.order[i]];
+
+    game->doMove(move);
+    countNode();
+    int score;
+    if (game->hasMoveableBoards()) {
+      score = searchMoves(depth, alpha, beta, turnPly, ply + 1);
+    } else if (turnPly == 0 and rootMade > 0 and game->isInCheck(color)) {
+      // the moves made before the search are the only ones the LEGAL filter did not check
+      score = NO_TURN;
+    } else {
+      game->doSubmit();
+      score = -searchTurn(depth - 1, -beta, -alpha, turnPly + 1, ply + 1);
+      game->undoSubmit();
+      if (turnPly == 0 and not aborted and score > rootScore) {
+        std::span<const PackedMove> turn = game->currentTurnMoves();
+        rootTurn.assign(turn.begin() + rootMade, turn.end());
+        rootScore = score;
+      }
+    }
+    game->undoMove();
+    if (aborted) {
+      return 0;
+    }
+    if (score == NO_TURN) {
+      continue;
+    }
+
+    completed += 1;
+    if (score > best) {
+      best = score;
+      bestMove = move;
+    }
+    alpha = std::max(alpha, best);
+    if (alpha >= beta) {
+      if (not move.hasFlag(PackedMove::CAPTURE) and not move.hasFlag(PackedMove::PROMOTION)) {
+        if (node.killers[0] != move) {
+          node.killers[1] = node.killers[0];
+          node.killers[0] = move;
+        }
+        int& counter = history[int(color)][Board::squareOf(move.from())][Board::squareOf(move.to())];
+        counter = std::min(counter + depth * depth, HISTORY_LIMIT);
+      }
+      break;
+    }
+    if (narrow and completed >= engine._turnWidth) {
+      break;
+    }
+  }
+
+  if (best == NO_TURN and not complete) {
+    // the moves that did not fit might complete the turn, the position is only evaluated
+    return engine._evaluator.evaluate(*game);
+  }
+  if (best != NO_TURN) {
+    TranspositionTable::Bound bound = best <= originalAlpha ? TranspositionTable::UPPER
+                                    : best >= beta ? TranspositionTable::LOWER : TranspositionTable::EXACT;
+    engine._table.store(key, TranspositionTable::Entry{bestMove, toTable(best, turnPly), depth, bound});
+  }
+  return best;
+}
+
+int AlphaBetaEngine::_Worker::orderScore(PackedMove move, PackedMove hashMove, const _Ply& node) const {
+  if (move == hashMove) {
+    return HASH_MOVE_ORDER;
+  }
+  if (move.hasFlag(PackedMove::CAPTURE)) {
+    PieceCode attacker = game->tipBoard(move.fromTimeLine()).pieceAt(move.from());
+    return CAPTURE_ORDER + captureValue(*game, move) * 16 - Evaluation::PIECE_VALUES[int(pieceTypeOf(attacker))] / 16;
+  }
+  if (move.hasFlag(PackedMove::PROMOTION)) {
+    return PROMOTION_ORDER;
+  }
+  if (move == node.killers[0] or move == node.killers[1]) {
+    return KILLER_ORDER + (move == node.killers[0]);
+  }
+  // moves staying on their board first, then moves through time, then moves creating a timeline
+  int kind = move.hasFlag(PackedMove::BRANCHING) ? 2 : move.hasFlag(PackedMove::TIME_TRAVEL) ? 1 : 0;
+  int counter = history[int(game->getCurrentTurnColor())][Board::squareOf(move.from())][Board::squareOf(move.to())];
+  return counter * 4 + 2 - kind;
+}
+
+} // namespace Chess
@@ -0,0 +1,19 @@
+#include "Engine/Evaluator.h"
+
+namespace Chess {
+
+int Evaluator::evaluate(const IGame& game) const {
+  int score = game.tipsScore() + _weights.timeLine * game.timeLineBalance();
+  if (_weights.presentLine != 0) {
+    int present = 0;
+    for (int timeLineID = 0; timeLineID < game.timeLineCount(); timeLineID += 1) {
+      if (game.isMoveable(timeLineID)) {
+        present += game.tipBoard(timeLineID).score();
+      }
+    }
+    score += present * _weights.presentLine / 100;
+  }
+  return game.getCurrentTurnColor() == PieceColor::PIECEWHITE ? score : -score;
+}
+
+} // namespace Chess
@@ -0,0 +1,27 @@
+#include "Engine/IEngine.h"
+
+namespace Chess {
+
+bool generateTurnMoves(const IGame& game, std::vector<PackedMove>& moves, std::vector<int>& boards, MoveBuffer& buffer) {
+  moves.clear();
+  boards.clear();
+  bool complete = true;
+  for (int timeLineID = 0; timeLineID < game.timeLineCount(); timeLineID += 1) {
+    if (not game.isMoveable(timeLineID)) continue;
+    boards.push_back(timeLineID);
+    buffer.clear();
+    complete = game.generateMoves(timeLineID, buffer, MoveFilter::LEGAL) == buffer.size() and complete;
+    moves.insert(moves.end(), buffer.begin(), buffer.end());
+  }
+  return complete;
+}
+
+int captureValue(const IGame& game, PackedMove move) {
+  if (not move.hasFlag(PackedMove::CAPTURE)) {
+    return 0;
+  }
+  PieceCode victim = game.peekBoard(move.toTimeLine(), move.toHalfTurn())->pieceAt(move.to());
+  return Evaluation::PIECE_VALUES[int(pieceTypeOf(victim))];
+}
+
+} // namespace Chess
@@ -0,0 +1,425 @@
+#include "Engine/MCTSEngine.h"
+#include <algorithm>
+
+namespace Chess {
+
+void MCTSEngine::_Node::reset(PackedMove move, PieceColor mover) {
+  this->move = move;
+  this->mover = mover;
+  state.store(UNEXPANDED, std::memory_order_relaxed);
+  terminalResult.store(0, std::memory_order_relaxed);
+  visits.store(0, std::memory_order_relaxed);
+  virtualLosses.store(0, std::memory_order_relaxed);
+  results.store(0, std::memory_order_relaxed);
+  firstChild = 0;
+  childCount = 0;
+}
+
+MCTSEngine::MCTSEngine(int threads, std::size_t nodeCapacity) {
+  setThreads(threads);
+  setNodeCapacity(nodeCapacity);
+}
+
+MCTSEngine::~MCTSEngine(void) = default;
+
+void MCTSEngine::setThreads(int threads) {
+  assert(threads > 0);
+  _pool.resize(threads);
+  while (int(_workers.size()) > threads) {
+    _workers.pop_back();
+  }
+  while (int(_workers.size()) < threads) {
+    _workers.push_back(std::make_unique<_Worker>());
+    // distinct seeds, so that the threads do not play the same playouts
+    _workers.back()->random = 0x9E3779B97F4A7C15ULL * _workers.size();
+  }
+}
+
+void MCTSEngine::setNodeCapacity(std::size_t nodes) {
+  assert(nodes > 0 and nodes <= UINT32_MAX);
+  _nodes = std::make_unique<_Node[]>(nodes);
+  _capacity = nodes;
+}
+
+SearchResult MCTSEngine::findBestTurn(const IGame& game, const SearchLimits& limits) {
+  _start = std::chrono::steady_clock::now();
+  _limits = limits;
+  _stop.store(false, std::memory_order_relaxed);
+  _iterations.store(0, std::memory_order_relaxed);
+  _moves.store(0, std::memory_order_relaxed);
+
+  SearchResult result;
+  for (std::unique_ptr<_Worker>& worker : _workers) {
+    worker->nodes = 0;
+  }
+  if (not game.gameEnd() and game.hasMoveableBoards()) {
+    // the tree is rebuilt for every search, the root stands for the moves made so far
+    _nodes[0].reset(PackedMove(), opposite(game.getCurrentTurnColor()));
+    _used.store(1, std::memory_order_relaxed);
+    _pool.run([this, &game](int index) {
+      _run(*_workers[index], game);
+    });
+    _bestTurn(game, result);
+  }
+  for (std::unique_ptr<_Worker>& worker : _workers) {
+    result.nodes += worker->nodes;
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+  return result;
+}
+
+void MCTSEngine::_run(_Worker& worker, const IGame& root) {
+  // the snapshot is taken by the thread itself, the root is only read
+  worker.game = root.snapshot();
+  worker.rootMade = int(worker.game->currentTurnMoves().size());
+  worker.turns = 0;
+  worker.unreported = 0;
+  worker.submitted.clear();
+  while (not _limitReached()) {
+    NodeState state = _nodes[0].state.load(std::memory_order_acquire);
+    if (state == TERMINAL or state == DEAD) {
+      break;
+    }
+    _iterate(worker);
+    _moves.fetch_add(worker.unreported, std::memory_order_relaxed);
+    worker.unreported = 0;
+    _iterations.fetch_add(1, std::memory_order_relaxed);
+  }
+  worker.game.reset();
+}
+
+bool MCTSEngine::_limitReached(void) const {
+  if (_stop.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (_limits.nodes > 0 and _moves.load(std::memory_order_relaxed) >= _limits.nodes) {
+    return true;
+  }
+  if (_limits.time.count() > 0 and std::chrono::steady_clock::now() >= _start + _limits.time) {
+    return true;
+  }
+  return _limits.nodes == 0 and _limits.time.count() == 0
+    and _iterations.load(std::memory_order_relaxed) >= DEFAULT_ITERATIONS;
+}
+
+void MCTSEngine::_iterate(_Worker& worker) {
+  std::vector<u32>& path = worker.path;
+  path.clear();
+  path.push_back(0);
+  _nodes[0].virtualLosses.fetch_add(_virtualLoss, std::memory_order_relaxed);
+
+  u32 index = 0;
+  bool expanded = false;
+  double result = -1; // the result for white, nothing is backed up while it is negative
+  while (true) {
+    _Node& node = _nodes[index];
+    NodeState state = node.state.load(std::memory_order_acquire);
+    // one node is expanded per iteration, the thread losing the race plays out from it meanwhile
+    if (state == UNEXPANDED and not expanded
+        and node.state.compare_exchange_strong(state, EXPANDING, std::memory_order_acq_rel)) {
+      _expand(worker, node);
+      expanded = true;
+      state = node.state.load(std::memory_order_acquire);
+    }
+    if (state == TERMINAL) {
+      result = node.terminalResult.load(std::memory_order_relaxed) / 2.0;
+      break;
+    }
+    if (state == DEAD) {
+      break;
+    }
+    if (state != EXPANDED) {
+      result = _playout(worker);
+      break;
+    }
+
+    u32 child = _select(node);
+    if (child == 0) {
+      _settle(worker, node);
+      continue;
+    }
+    if (not _make(worker, _nodes[child].move)) {
+      _nodes[child].state.store(DEAD, std::memory_order_release);
+      break;
+    }
+    index = child;
+    path.push_back(child);
+    _nodes[child].virtualLosses.fetch_add(_virtualLoss, std::memory_order_relaxed);
+  }
+
+  while (not worker.submitted.empty()) {
+    _unmake(worker);
+  }
+  for (u32 visited : path) {
+    _Node& node = _nodes[visited];
+    if (result >= 0) {
+      double value = node.mover == PieceColor::PIECEWHITE ? result : 1 - result;
+      node.results.fetch_add(u64(value * RESULT_SCALE + 0.5), std::memory_order_relaxed);
+      node.visits.fetch_add(1, std::memory_order_relaxed);
+    }
+    node.virtualLosses.fetch_sub(_virtualLoss, std::memory_order_relaxed);
+  }
+}
+
+u32 MCTSEngine::_select(const _Node& node) const {
+  double parentVisits = node.visits.load(std::memory_order_relaxed) + node.virtualLosses.load(std::memory_order_relaxed);
+  double logVisits = std::log(parentVisits + 1);
+  u32 best = 0;
+  double bestValue = -1;
+  for (u32 index = node.firstChild; index < node.firstChild + node.childCount; index += 1) {
+    const _Node& child = _nodes[index];
+    if (child.state.load(std::memory_order_relaxed) == DEAD) continue;
+    // a virtual loss is a visit without result
+    u32 visits = child.visits.load(std::memory_order_relaxed) + child.virtualLosses.load(std::memory_order_relaxed);
+    if (visits == 0) {
+      // the children are tried once each, in the order of _expand
+      return index;
+    }
+    double value = child.results.load(std::memory_order_relaxed) / RESULT_SCALE / visits
+                 + _exploration * std::sqrt(logVisits / visits);
+    if (value > bestValue) {
+      best = index;
+      bestValue = value;
+    }
+  }
+  return best;
+}
+
+void MCTSEngine::_expand(_Worker& worker, _Node& node) {
+  IGame& game = *worker.game;
+  if (not generateTurnMoves(game, worker.moves, worker.boards, worker.buffer)) {
+    // children from a truncated list could all die without proving anything, the node stays a leaf
+    node.state.store(UNEXPANDED, std::memory_order_release);
+    return;
+  }
+  int pivot = choosePivot(game, worker.moves, worker.boards, worker.options);
+  if (pivot < 0) {
+    _settle(worker, node);
+    return;
+  }
+
+  worker.children.clear();
+  for (PackedMove move : worker.moves) {
+    if (settles(game, move, pivot)) {
+      int order = captureValue(game, move) + (move.hasFlag(PackedMove::PROMOTION) ? Evaluation::PIECE_VALUES[int(PieceType::PIECEQUEEN)] : 0);
+      worker.children.emplace_back(order, move);
+    }
+  }
+  std::stable_sort(worker.children.begin(), worker.children.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  u32 count = u32(worker.children.size());
+  // the check first keeps the pool counter from growing once the pool is full
+  if (_used.load(std::memory_order_relaxed) + count > _capacity) {
+    node.state.store(UNEXPANDED, std::memory_order_release);
+    return;
+  }
+  u32 first = _used.fetch_add(count, std::memory_order_relaxed);
+  if (first + count > _capacity) {
+    node.state.store(UNEXPANDED, std::memory_order_release);
+    return;
+  }
+  PieceColor mover = game.getCurrentTurnColor();
+  for (u32 i = 0; i < count; i += 1) {
+    _nodes[first + i].reset(worker.children[i].second, mover);
+  }
+  node.firstChild = first;
+  node.childCount = count;
+  node.state.store(EXPANDED, std::memory_order_release);
+}
+
+void MCTSEngine::_settle(_Worker& worker, _Node& node) {
+  IGame& game = *worker.game;
+  if (game.undoable()) {
+    node.state.store(DEAD, std::memory_order_release);
+    return;
+  }
+  // without a legal turn the player is mated, or stalemated when not in check
+  PieceColor color = game.getCurrentTurnColor();
+  u8 result = not game.isInCheck(color) ? 1 : color == PieceColor::PIECEWHITE ? 0 : 2;
+  node.terminalResult.store(result, std::memory_order_relaxed);
+  node.state.store(TERMINAL, std::memory_order_release);
+}
+
+double MCTSEngine::_playout(_Worker& worker) {
+  IGame& game = *worker.game;
+  std::size_t made = worker.submitted.size();
+  // a partial turn is completed first
+  int turns = _policy.turns + (game.undoable() ? 1 : 0);
+  double result = -1;
+  for (int turn = 0; turn < turns; turn += 1) {
+    TurnOutcome outcome = _playTurn(worker);
+    if (outcome == NO_TURN) {
+      PieceColor color = game.getCurrentTurnColor();
+      result = not game.isInCheck(color) ? 0.5 : color == PieceColor::PIECEWHITE ? 0 : 1;
+      break;
+    }
+    if (outcome == GAVE_UP) {
+      break;
+    }
+  }
+  if (result < 0) {
+    result = _evaluate(game);
+  }
+  while (worker.submitted.size() > made) {
+    _unmake(worker);
+  }
+  return result;
+}
+
+MCTSEngine::TurnOutcome MCTSEngine::_playTurn(_Worker& worker) {
+  IGame& game = *worker.game;
+  std::size_t made = worker.submitted.size();
+  for (int attempt = 0; attempt < PLAYOUT_TRIES; attempt += 1) {
+    // a greedy try that failed would fail again, the next tries are uniform
+    bool greedy = attempt == 0 and _policy.kind == PlayoutPolicy::CAPTURES_FIRST;
+    while (true) {
+      if (not generateTurnMoves(game, worker.moves, worker.boards, worker.buffer)) {
+        // a truncated list proves nothing, the evaluation decides
+        while (worker.submitted.size() > made) {
+          _unmake(worker);
+        }
+        return GAVE_UP;
+      }
+      int pivot = choosePivot(game, worker.moves, worker.boards, worker.options);
+      if (pivot < 0 or not _make(worker, _playoutMove(worker, pivot, greedy))) {
+        break;
+      }
+      if (worker.submitted.back()) {
+        return PLAYED;
+      }
+    }
+    if (worker.submitted.size() == made and not game.undoable()) {
+      return NO_TURN;
+    }
+    while (worker.submitted.size() > made) {
+      _unmake(worker);
+    }
+  }
+  return GAVE_UP;
+}
+
+PackedMove MCTSEngine::_playoutMove(_Worker& worker, int pivot, bool greedy) {
+  const IGame& game = *worker.game;
+  if (greedy) {
+    PackedMove best;
+    int bestValue = 0;
+    for (PackedMove move : worker.moves) {
+      if (not settles(game, move, pivot)) continue;
+      int value = captureValue(game, move) + (move.hasFlag(PackedMove::PROMOTION) ? Evaluation::PIECE_VALUES[int(PieceType::PIECEQUEEN)] : 0);
+      if (value > bestValue) {
+        best = move;
+        bestValue = value;
+      }
+    }
+    if (bestValue > 0) {
+      return best;
+    }
+  }
+  int count = 0;
+  for (PackedMove move : worker.moves) {
+    count += settles(game, move, pivot);
+  }
+  // choosePivot found a move settling the pivot
+  assert(count > 0);
+  int chosen = int(_nextRandom(worker.random) % u64(count));
+  for (PackedMove move : worker.moves) {
+    if (settles(game, move, pivot) and chosen-- == 0) {
+      return move;
+    }
+  }
+  return PackedMove();
+}
+
+bool MCTSEngine::_make(_Worker& worker, PackedMove move) {
+  IGame& game = *worker.game;
+  PieceColor color = game.getCurrentTurnColor();
+  game.doMove(move);
+  worker.nodes += 1;
+  worker.unreported += 1;
+  bool submit = not game.hasMoveableBoards();
+  if (submit and worker.turns == 0 and worker.rootMade > 0 and game.isInCheck(color)) {
+    game.undoMove();
+    return false;
+  }
+  if (submit) {
+    game.doSubmit();
+    worker.turns += 1;
+  }
+  worker.submitted.push_back(submit);
+  return true;
+}
+
+void MCTSEngine::_unmake(_Worker& worker) {
+  IGame& game = *worker.game;
+  if (worker.submitted.back()) {
+    game.undoSubmit();
+    worker.turns -= 1;
+  }
+  worker.submitted.pop_back();
+  game.undoMove();
+}
+
+void MCTSEngine::_bestTurn(const IGame& game, SearchResult& result) const {
+  PieceColor color = game.getCurrentTurnColor();
+  const _Node& root = _nodes[0];
+  if (root.state.load(std::memory_order_acquire) == TERMINAL) {
+    // mated or stalemated, see _settle
+    result.score = root.terminalResult.load(std::memory_order_relaxed) == 1 ? 0 : -MATE_SCORE;
+    return;
+  }
+
+  // the most visited line, followed on a snapshot to know where the turns end
+  std::shared_ptr<IGame> line = game.snapshot();
+  u32 index = 0;
+  while (true) {
+    const _Node& node = _nodes[index];
+    if (node.state.load(std::memory_order_acquire) != EXPANDED) break;
+    u32 best = 0;
+    u32 bestVisits = 0;
+    for (u32 child = node.firstChild; child < node.firstChild + node.childCount; child += 1) {
+      u32 visits = _nodes[child].visits.load(std::memory_order_relaxed);
+      if (_nodes[child].state.load(std::memory_order_relaxed) != DEAD and visits > bestVisits) {
+        best = child;
+        bestVisits = visits;
+      }
+    }
+    if (best == 0) break;
+
+    const _Node& child = _nodes[best];
+    line->doMove(child.move);
+    if (result.depth == 0) {
+      result.turn.push_back(child.move);
+      if (index == 0) {
+        double value = std::clamp(child.results.load(std::memory_order_relaxed) / RESULT_SCALE / bestVisits, 1e-6, 1 - 1e-6);
+        result.score = int(std::lround(RESULT_SPREAD * std::log(value / (1 - value))));
+      }
+    }
+    if (not line->hasMoveableBoards()) {
+      line->doSubmit();
+      if (result.depth == 0 and child.state.load(std::memory_order_acquire) == TERMINAL) {
+        u8 opponentResult = child.terminalResult.load(std::memory_order_relaxed);
+        bool mates = color == PieceColor::PIECEWHITE ? opponentResult == 2 : opponentResult == 0;
+        result.score = mates ? MATE_SCORE - 1 : 0;
+      }
+      result.depth += 1;
+    }
+    index = best;
+  }
+  if (result.depth > 0) {
+    return;
+  }
+
+  // the tree ends within the turn, the solver completes it
+  std::vector<PackedMove> rest;
+  if (TurnSolver(*line).hasLegalTurn(&rest)) {
+    result.turn.insert(result.turn.end(), rest.begin(), rest.end());
+  } else {
+    line = game.snapshot();
+    result.turn.clear();
+    TurnSolver(*line).hasLegalTurn(&result.turn);
+  }
+  result.depth = result.turn.empty() ? 0 : 1;
+}
+
+} // namespace Chess
@@ -0,0 +1,71 @@
+#include "Engine/ThreadPool.h"
+#include <cassert>
+
+namespace Chess {
+
+ThreadPool::ThreadPool(int size) {
+  resize(size);
+}
+
+ThreadPool::~ThreadPool(void) {
+  _stopThreads();
+}
+
+void ThreadPool::resize(int size) {
+  assert(size > 0);
+  if (size == this->size()) {
+    return;
+  }
+  _stopThreads();
+  for (int index = 1; index < size; index += 1) {
+    _threads.emplace_back(&ThreadPool::_loop, this, index, _generation);
+  }
+}
+
+void ThreadPool::run(const std::function<void(int)>& job) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _job = &job;
+    _pending = int(_threads.size());
+    _generation += 1;
+  }
+  _wake.notify_all();
+  job(0);
+  std::unique_lock<std::mutex> lock(_mutex);
+  _done.wait(lock, [this] { return _pending == 0; });
+  _job = nullptr;
+}
+
+void ThreadPool::_loop(int index, unsigned seen) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _wake.wait(lock, [this, seen] { return _quit or _generation != seen; });
+    if (_quit) {
+      return;
+    }
+    seen = _generation;
+    const std::function<void(int)>& job = *_job;
+    lock.unlock();
+    job(index);
+    lock.lock();
+    _pending -= 1;
+    if (_pending == 0) {
+      _done.notify_one();
+    }
+  }
+}
+
+void ThreadPool::_stopThreads(void) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _quit = true;
+  }
+  _wake.notify_all();
+  for (std::thread& thread : _threads) {
+    thread.join();
+  }
+  _threads.clear();
+  _quit = false;
+}
+
+} // namespace Chess
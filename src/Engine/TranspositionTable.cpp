@@ -0,0 +1,70 @@
+#include "Engine/TranspositionTable.h"
+
+namespace Chess {
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) {
+  resize(megabytes);
+}
+
+void TranspositionTable::resize(std::size_t megabytes) {
+  std::size_t count = 1;
+  while (count * 2 * sizeof(_Bucket) <= std::max<std::size_t>(megabytes, 1) << 20) {
+    count *= 2;
+  }
+  _buckets = std::make_unique<_Bucket[]>(count);
+  _bucketCount = count;
+  _generation = 0;
+}
+
+void TranspositionTable::clear(void) {
+  for (std::size_t i = 0; i < _bucketCount; i += 1) {
+    for (_Slot& slot : _buckets[i].slots) {
+      slot.check.store(0, std::memory_order_relaxed);
+      slot.move.store(0, std::memory_order_relaxed);
+      slot.data.store(0, std::memory_order_relaxed);
+    }
+  }
+  _generation = 0;
+}
+
+bool TranspositionTable::probe(u64 key, Entry& entry) const {
+  for (const _Slot& slot : _bucketOf(key).slots) {
+    u64 move = slot.move.load(std::memory_order_relaxed);
+    u64 data = slot.data.load(std::memory_order_relaxed);
+    if ((slot.check.load(std::memory_order_relaxed) ^ move ^ data) != key or data == 0) continue;
+    entry.move = PackedMove::fromBits(move);
+    entry.score = int(u32(data));
+    entry.depth = int(data >> 32 & 0xff);
+    entry.bound = Bound(data >> 40 & 0xff);
+    return true;
+  }
+  return false;
+}
+
+void TranspositionTable::store(u64 key, const Entry& entry) {
+  _Bucket& bucket = _bucketOf(key);
+  _Slot* victim = nullptr;
+  int victimWorth = INT_MAX;
+  for (_Slot& slot : bucket.slots) {
+    u64 move = slot.move.load(std::memory_order_relaxed);
+    u64 data = slot.data.load(std::memory_order_relaxed);
+    if ((slot.check.load(std::memory_order_relaxed) ^ move ^ data) == key) {
+      victim = &slot;
+      break;
+    }
+    // entries of older searches are worth less than any entry of this one
+    int age = int((_generation - (data >> 48)) & GENERATION_MASK);
+    int worth = data == 0 ? -1 : int(data >> 32 & 0xff) - age * 256;
+    if (worth < victimWorth) {
+      victim = &slot;
+      victimWorth = worth;
+    }
+  }
+  u64 move = entry.move.bits();
+  u64 data = _pack(entry, _generation);
+  victim->check.store(key ^ move ^ data, std::memory_order_relaxed);
+  victim->move.store(move, std::memory_order_relaxed);
+  victim->data.store(data, std::memory_order_relaxed);
+}
+
+} // namespace Chess
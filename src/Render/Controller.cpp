@@ -285,7 +285,7 @@ void ChessController::handleSelectedToPosition(Chess::SelectedPosition selectedP
     newestBoardView->setBoardTexture(&ResourceManager::getInstance().getTexture2D("mainChessBoard"));
     newestBoardView->setRenderArea({
         static_cast<float>(newestBoard->halfTurnNumber()) * (BOARD_WORLD_SIZE + HORIZONTAL_SPACING),
-        static_cast<float>(newestBoard->getTimeLine()->ID()) * (BOARD_WORLD_SIZE + VERTICAL_SPACING),
+        static_cast<float>(newestBoard->timeLineID()) * (BOARD_WORLD_SIZE + VERTICAL_SPACING),
         BOARD_WORLD_SIZE,
         BOARD_WORLD_SIZE
     });
@@ -358,20 +358,17 @@ std::vector<std::shared_ptr<BoardView>> ChessController::computeBoardView2DsFrom
     boardView->setBoardTexture(&ResourceManager::getInstance().getTexture2D("mainChessBoard"));
     boardView->setRenderArea({
         static_cast<float>(board->halfTurnNumber()) * (BOARD_WORLD_SIZE + HORIZONTAL_SPACING),
-        static_cast<float>(board->getTimeLine()->ID()) * (BOARD_WORLD_SIZE + VERTICAL_SPACING),
+        static_cast<float>(board->timeLineID()) * (BOARD_WORLD_SIZE + VERTICAL_SPACING),
         BOARD_WORLD_SIZE,
         BOARD_WORLD_SIZE
     });
 
     std::vector<std::pair<Chess::Position2D, std::string>> piecePositions;
-    for (int x = 0; x < board->dim(); ++x) {
-      for (int y = 0; y < board->dim(); ++y) {
-        auto piece = board->getPiece(Chess::Position2D(x, y));
-        if (piece) {
-          const std::string& pieceColor = (piece->color() == Chess::PieceColor::PIECEWHITE) ? "white" : "black";
-          const std::string& pieceName = pieceColor + "_" + piece->name();
-          piecePositions.emplace_back(Chess::Position2D(x, y), pieceName);
-        }
+    for (Chess::PieceColor color : {Chess::PieceColor::PIECEWHITE, Chess::PieceColor::PIECEBLACK}) {
+      const std::string& pieceColor = (color == Chess::PieceColor::PIECEWHITE) ? "white" : "black";
+      for (const Chess::PlacedPiece& piece : board->pieces(color)) {
+        const std::string& pieceName = pieceColor + "_" + Chess::pieceTypeName(Chess::pieceTypeOf(piece.code));
+        piecePositions.emplace_back(piece.position, pieceName);
       }
     }
     boardView->setPiecePositions(piecePositions);
@@ -471,8 +468,7 @@ void ChessController::updateMenuButtonStates() {
 
   // Update Submit button: enabled if there are no moveable boards (turn can be submitted)
   if (submitItem) {
-    std::vector<std::shared_ptr<Chess::Board>> moveableBoards = model._game->getMoveableBoards();
-    bool canSubmit = moveableBoards.empty() && !model._game->gameEnd();
+    bool canSubmit = !model._game->hasMoveableBoards() && !model._game->gameEnd();
     submitItem->setEnabled(canSubmit);
   }
 
@@ -29,7 +29,7 @@ void TestingScene::init(void) {
 
   // auto boardViews = _chessController->computeBoardView2DsFromModel();
   // for (auto& boardView : boardViews) {
-  //   std::cout << "Adding BoardView with ID: " << boardView->getBoard()->getTimeLine()->ID() << std::endl;
+  //   std::cout << "Adding BoardView with ID: " << boardView->getBoard()->timeLineID() << std::endl;
   // }
   // _chessController->handleInput();
   // for (auto timeLine : _chessModel->getTimeLines()) {
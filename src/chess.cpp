@@ -11,56 +11,385 @@ Vector4D::Vector4D(int x, int y, int z, int w) : _data({x, y, z, w}) {}
 Piece::Piece(PieceColor color, std::shared_ptr<Board> board, Position2D position)
     : _color(color), _board(board), _position(position) {}
 
-Board::Board(int N, std::shared_ptr<TimeLine> timeLine, int halfTurnNumber) : _N(N), _halfTurnNumber(halfTurnNumber), _previousBoard(nullptr), _timeLine(timeLine) {
-  _pieces.resize(N, std::vector<std::shared_ptr<Piece>>(N, nullptr));
+GameArena::GameArena(std::size_t initialSize) : _resource(initialSize), _bytesAllocated(0) {}
+
+std::shared_ptr<Piece> makePiece(PieceCode code, std::shared_ptr<Board> board, Position2D position) {
+  assert(code != EMPTY_SQUARE);
+  PieceColor color = pieceColorOf(code);
+  switch (pieceTypeOf(code)) {
+    case PieceType::PIECEKING: return std::make_shared<King>(color, board, position);
+    case PieceType::PIECEQUEEN: return std::make_shared<Queen>(color, board, position);
+    case PieceType::PIECEROOK: return std::make_shared<Rook>(color, board, position);
+    case PieceType::PIECEBISHOP: return std::make_shared<Bishop>(color, board, position);
+    case PieceType::PIECEKNIGHT: return std::make_shared<Knight>(color, board, position);
+    case PieceType::PIECEPAWN: return std::make_shared<Pawn>(color, board, position);
+  }
+  return nullptr;
+}
+
+Board::Board(int N, std::shared_ptr<TimeLine> timeLine, int halfTurnNumber) : _N(N), _halfTurnNumber(halfTurnNumber), _state{}, _changedSquares(0), _attacks{}, _timeLineID(timeLine ? timeLine->ID() : -1) {
+  assert(N > 0 && N <= MAX_DIM);
 }
 
-void Board::placePiece(Position2D position, std::shared_ptr<Piece> piece) {
+void Board::placePiece(Position2D position, PieceCode code) {
   assert(position.x() >= 0 && position.x() < _N);
   assert(position.y() >= 0 && position.y() < _N);
-  if (piece != nullptr) {
-    piece->setBoard(shared_from_this());
-    piece->setPosition(position);
+  int square = squareOf(position);
+  u64 bit = u64(1) << square;
+  PieceCode previous = pieceAt(position);
+  _state.hash ^= Zobrist::pieceKey(square, previous) ^ Zobrist::pieceKey(square, code);
+  _state.score += Evaluation::pieceSquare(_N, square, code) - Evaluation::pieceSquare(_N, square, previous);
+  for (int color = 0; color < 2; color += 1) {
+    _state.colorMasks[color] &= ~bit;
+    for (u64& mask : _state.pieceMasks[color]) {
+      mask &= ~bit;
+    }
   }
-  _pieces[position.x()][position.y()] = std::move(piece);
+  if (code != EMPTY_SQUARE) {
+    _state.colorMasks[int(pieceColorOf(code))] |= bit;
+    _state.pieceMasks[int(pieceColorOf(code))][int(pieceTypeOf(code))] |= bit;
+  }
+  _changedSquares |= bit;
 }
 
 std::shared_ptr<Piece> Board::getPiece(Position2D position) const {
   assert(position.x() >= 0 && position.x() < _N);
   assert(position.y() >= 0 && position.y() < _N);
-  return _pieces[position.x()][position.y()];
+  PieceCode code = pieceAt(position);
+  if (code == EMPTY_SQUARE) {
+    return nullptr;
+  }
+  return makePiece(code, std::const_pointer_cast<Board>(shared_from_this()), position);
 }
 
-std::shared_ptr<Board> Board::createFork(std::shared_ptr<TimeLine> timeLine) {
-  std::shared_ptr<Board> forkedBoard = std::make_shared<Board>(_N, timeLine);
-  for (int x = 0; x < _N; ++x) {
-    for (int y = 0; y < _N; ++y) {
-      std::shared_ptr<Piece> piece = _pieces[x][y];
-      if (piece != nullptr) {
-        forkedBoard->placePiece(Position2D(x, y), std::shared_ptr<Piece>(piece->clone()));
+u64 Board::rayMask(Position2D from, int dx, int dy) const {
+  u64 ray = 0;
+  u64 occupied = occupancy();
+  for (int x = from.x() + dx, y = from.y() + dy; x >= 0 && x < _N && y >= 0 && y < _N; x += dx, y += dy) {
+    u64 bit = u64(1) << squareOf(Position2D(x, y));
+    ray |= bit;
+    if (occupied & bit) break;
+  }
+  return ray;
+}
+
+/**
+ * Get the squares a step on the board can be taken from without leaving it.
+ * @param N The dimension of the board.
+ * @param dx The step along the x axis, in [-2, 2].
+ * @param dy The step along the y axis, in [-2, 2].
+ * @return The mask of the squares of an N x N board whose step lands on the board.
+ */
+static inline u64 stepSources(int N, int dx, int dy) {
+  static const std::array<std::array<u64, 25>, Board::MAX_DIM + 1> table = [] {
+    std::array<std::array<u64, 25>, Board::MAX_DIM + 1> masks{};
+    for (int n = 1; n <= Board::MAX_DIM; n += 1) {
+      for (int step = 0; step < 25; step += 1) {
+        int sx = step / 5 - 2, sy = step % 5 - 2;
+        for (int x = 0; x < n; x += 1) {
+          for (int y = 0; y < n; y += 1) {
+            if (x + sx >= 0 and x + sx < n and y + sy >= 0 and y + sy < n) {
+              masks[n][step] |= u64(1) << Board::squareOf(Position2D(x, y));
+            }
+          }
+        }
       }
     }
+    return masks;
+  }();
+  return table[N][(dx + 2) * 5 + dy + 2];
+}
+
+/**
+ * Move every square of a mask by a step on the board.
+ * The squares whose step leaves the board must be masked out first, see stepSources.
+ */
+static inline u64 shiftSquares(u64 squares, int dx, int dy) {
+  int shift = dx * Board::MAX_DIM + dy;
+  return shift >= 0 ? squares << shift : squares >> -shift;
+}
+
+/**
+ * Get the squares attacked by sliders in one direction, all sliders at once.
+ * Same squares as the union of Board::rayMask over the sliders.
+ */
+static inline u64 slideAttacks(u64 sliders, u64 empty, int N, int dx, int dy) {
+  u64 sources = stepSources(N, dx, dy);
+  u64 flood = sliders;
+  for (u64 ray = sliders; ray; ) {
+    ray = shiftSquares(ray & sources, dx, dy) & empty;
+    flood |= ray;
+  }
+  return shiftSquares(flood & sources, dx, dy);
+}
+
+void Board::_updateAttacks(void) {
+  // every piece of a type is moved at once, a board update costs the same whatever the number of pieces
+  auto leaps = [this](u64 leapers, std::span<const Offset4D> steps) {
+    u64 mask = 0;
+    if (leapers == 0) {
+      return mask;
+    }
+    for (const Offset4D& step : steps) {
+      if (step.z != 0 or step.w != 0) continue;
+      mask |= shiftSquares(leapers & stepSources(_N, step.x, step.y), step.x, step.y);
+    }
+    return mask;
+  };
+
+  u64 empty = ~occupancy();
+  for (int color = 0; color < 2; color += 1) {
+    const std::array<u64, PIECE_TYPE_COUNT>& masks = _state.pieceMasks[color];
+    u64 queens = masks[int(PieceType::PIECEQUEEN)];
+    u64 orthogonal = masks[int(PieceType::PIECEROOK)] | queens;
+    u64 diagonal = masks[int(PieceType::PIECEBISHOP)] | queens;
+    u64 attacks = 0;
+    if (orthogonal) {
+      attacks |= slideAttacks(orthogonal, empty, _N, 1, 0) | slideAttacks(orthogonal, empty, _N, -1, 0)
+               | slideAttacks(orthogonal, empty, _N, 0, 1) | slideAttacks(orthogonal, empty, _N, 0, -1);
+    }
+    if (diagonal) {
+      attacks |= slideAttacks(diagonal, empty, _N, 1, 1) | slideAttacks(diagonal, empty, _N, 1, -1)
+               | slideAttacks(diagonal, empty, _N, -1, 1) | slideAttacks(diagonal, empty, _N, -1, -1);
+    }
+    attacks |= leaps(masks[int(PieceType::PIECEKNIGHT)], Directions::KNIGHT);
+    attacks |= leaps(masks[int(PieceType::PIECEKING)], Directions::KING);
+    int8_t dy = PieceColor(color) == PieceColor::PIECEWHITE ? +1 : -1;
+    const Offset4D captures[] = {{-1, dy, 0, 0}, {+1, dy, 0, 0}};
+    attacks |= leaps(masks[int(PieceType::PIECEPAWN)], captures);
+    _attacks[color] = attacks;
   }
-  forkedBoard->_previousBoard = shared_from_this();
-  forkedBoard->_halfTurnNumber = _halfTurnNumber + 1;
+}
+
+std::shared_ptr<Board> Board::createFork(std::shared_ptr<TimeLine> timeLine) {
+  std::shared_ptr<Board> forkedBoard = arenaMakeShared<Board>(timeLine->arena(), _N, timeLine, _halfTurnNumber + 1);
+  forkedBoard->_forkFrom(*this, std::move(timeLine));
   return forkedBoard;
 }
 
-std::shared_ptr<TimeLine> Board::getTimeLine() const {
-  return _timeLine;
+void Board::_forkFrom(const Board& parent, std::shared_ptr<TimeLine> timeLine) {
+  assert(parent._N == _N);
+  _halfTurnNumber = parent._halfTurnNumber + 1;
+  _state = parent._state;
+  _changedSquares = 0;
+  _timeLineID = timeLine->ID();
+}
+
+TimeLine::TimeLine(int N, int IDX, int forkAt, std::shared_ptr<GameArena> arena)
+    : _N(N), _ID(IDX), _forkAt(forkAt), _historyMode(HistoryMode::SNAPSHOT), _keyframeInterval(DEFAULT_KEYFRAME_INTERVAL), _arena(arena) {}
+
+void TimeLine::_forkFrom(std::shared_ptr<TimeLine> parent, int newID, int forkAt) {
+  assert(_history.empty() and parent->_N == _N);
+  _ID = newID;
+  _forkAt = forkAt;
+  _historyMode = parent->_historyMode;
+  _keyframeInterval = parent->_keyframeInterval;
+  _materialized.clear();
+  _parent = std::move(parent);
 }
 
-TimeLine::TimeLine(int N, int IDX, int forkAt) : _N(N), _ID(IDX), _forkAt(forkAt), _parent(nullptr) {}
+std::shared_ptr<TimeLine> TimeLine::_share(std::shared_ptr<TimeLine> parent, std::shared_ptr<GameArena> arena) const {
+  std::shared_ptr<TimeLine> timeLine = arenaMakeShared<TimeLine>(arena, _N, _ID, _forkAt, arena);
+  timeLine->_historyMode = _historyMode;
+  timeLine->_keyframeInterval = _keyframeInterval;
+  timeLine->_history = _history;
+  timeLine->_parent = std::move(parent);
+  // the cached boards are as immutable as the others
+  timeLine->_materialized = _materialized;
+  return timeLine;
+}
 
 void TimeLine::pushBack(std::shared_ptr<Board> board) {
-  _history.push_back(board);
+  board->_updateAttacks();
+  HistoryEntry entry{board, BoardDelta(), true};
+  int pos = _history.size();
+  if (_historyMode == HistoryMode::DELTA and pos > 0 and pos % _keyframeInterval != 0) {
+    HistoryEntry& previous = _history.back();
+    u64 changed = 0;
+    for (int color = 0; color < 2; color += 1) {
+      for (int type = 0; type < PIECE_TYPE_COUNT; type += 1) {
+        changed |= previous.board->state().pieceMasks[color][type] ^ board->state().pieceMasks[color][type];
+      }
+    }
+    if (std::popcount(changed) <= BoardDelta::MAX_CHANGES) {
+      entry.keyframe = false;
+      for (; changed; changed &= changed - 1) {
+        int square = std::countr_zero(changed);
+        entry.delta.squares[entry.delta.count] = square;
+        entry.delta.codes[entry.delta.count] = board->pieceAt(Board::positionOf(square));
+        entry.delta.count += 1;
+      }
+    }
+    if (not previous.keyframe) {
+      // the old tip is the board most likely to be asked for next, keep it around in the cache
+      _materialized.insert(_materialized.begin(), {pos - 1, std::move(previous.board)});
+      if (_materialized.size() > MATERIALIZED_CACHE_SIZE) {
+        _materialized.pop_back();
+      }
+    }
+  }
+  _history.push_back(std::move(entry));
+}
+
+void TimeLine::popBack(void) {
+  assert(!_history.empty());
+  _history.pop_back();
+  int size = _history.size();
+  std::erase_if(_materialized, [size](const std::pair<int, std::shared_ptr<Board>>& cached) {
+    return cached.first >= size;
+  });
+  if (size > 0 and _history.back().board == nullptr) {
+    _history.back().board = _materialize(size - 1);
+  }
+}
+
+std::shared_ptr<Board> TimeLine::getBoardByHalfTurn(int halfTurn) const {
+  int pos = halfTurn - _forkAt - 1;
+  assert(pos >= 0 && pos < int(_history.size()));
+  if (_history[pos].board != nullptr) {
+    return _history[pos].board;
+  }
+  return _materialize(pos);
+}
+
+std::shared_ptr<Board> TimeLine::_materialize(int pos) const {
+  for (int i = 0; i < int(_materialized.size()); i += 1) {
+    if (_materialized[i].first == pos) {
+      std::rotate(_materialized.begin(), _materialized.begin() + i, _materialized.begin() + i + 1);
+      return _materialized.front().second;
+    }
+  }
+
+  int keyframe = pos;
+  while (not _history[keyframe].keyframe) {
+    keyframe -= 1;
+  }
+  assert(_history[keyframe].board != nullptr);
+  std::shared_ptr<Board> board = arenaMakeShared<Board>(_arena, _N, std::const_pointer_cast<TimeLine>(shared_from_this()), _forkAt + 1 + pos);
+  board->_state = _history[keyframe].board->state();
+  for (int i = keyframe + 1; i <= pos; i += 1) {
+    const BoardDelta& delta = _history[i].delta;
+    board->_changedSquares = 0;
+    for (int change = 0; change < delta.count; change += 1) {
+      board->placePiece(Board::positionOf(delta.squares[change]), delta.codes[change]);
+    }
+  }
+  board->_updateAttacks();
+
+  _materialized.insert(_materialized.begin(), {pos, board});
+  if (_materialized.size() > MATERIALIZED_CACHE_SIZE) {
+    _materialized.pop_back();
+  }
+  return board;
+}
+
+void TimeLine::setHistoryMode(HistoryMode mode, int keyframeInterval) {
+  assert(keyframeInterval > 0);
+  std::vector<std::shared_ptr<Board>> boards = getBoards();
+  _history.clear();
+  _materialized.clear();
+  _historyMode = mode;
+  _keyframeInterval = keyframeInterval;
+  for (std::shared_ptr<Board>& board : boards) {
+    pushBack(std::move(board));
+  }
+  // boards demoted while re-encoding were never asked for
+  _materialized.clear();
+}
+
+std::vector<std::shared_ptr<Board>> TimeLine::getBoards() const {
+  std::vector<std::shared_ptr<Board>> boards;
+  boards.reserve(_history.size());
+  for (int pos = 0; pos < int(_history.size()); pos += 1) {
+    boards.push_back(getBoardByHalfTurn(_forkAt + 1 + pos));
+  }
+  return boards;
+}
+
+IGame::IGame(const IGame& other)
+    : _N(other._N), _presentHalfTurn(other._presentHalfTurn), _turnStart(other._turnStart),
+      _currentTurnColor(other._currentTurnColor), _rule(other._rule), _gameWinner(other._gameWinner),
+      _arena(std::make_shared<GameArena>()), _index(other._index), _boardsHash(other._boardsHash),
+      _moveable(other._moveable), _moveableCount(other._moveableCount), _tipsScore(other._tipsScore),
+      _timeLineBalance(other._timeLineBalance), _kings(other._kings), _moveGenerator(other._moveGenerator),
+      _historyMode(other._historyMode), _keyframeInterval(other._keyframeInterval) {
+  // copied into reserved storage, so doMove and undoMove stay allocation-free on the copy
+  _nextHalfTurnBuffer.reserve(MAX_TURN_MOVES);
+  _nextHalfTurnBuffer.assign(other._nextHalfTurnBuffer.begin(), other._nextHalfTurnBuffer.end());
+  _currentTurnMoves.reserve(MAX_TURN_MOVES);
+  _currentTurnMoves.assign(other._currentTurnMoves.begin(), other._currentTurnMoves.end());
+  _undoBuffer.reserve(MAX_TURN_MOVES);
+  _undoBuffer.assign(other._undoBuffer.begin(), other._undoBuffer.end());
+  _turnBuffer.reserve(MAX_TURN_MOVES);
+  _turnBuffer.assign(other._turnBuffer.begin(), other._turnBuffer.end());
+  // the copy allocates from its own arena, the boards it shares keep the arena of this game alive
+  _timeLines.reserve(other._timeLines.size());
+  for (const std::shared_ptr<TimeLine>& timeLine : other._timeLines) {
+    std::shared_ptr<TimeLine> parent = timeLine->parent() ? _timeLines[timeLine->parent()->ID()] : nullptr;
+    _timeLines.push_back(timeLine->_share(std::move(parent), _arena));
+  }
+}
+
+std::shared_ptr<IGame> IGame::snapshot(void) const {
+  return std::shared_ptr<IGame>(new IGame(*this));
+}
+
+MemoryUsage IGame::memoryUsage(void) const {
+  MemoryUsage usage;
+  auto addBoard = [&usage](const std::shared_ptr<Board>& board) {
+    if (board != nullptr) {
+      usage.boards += sizeof(Board) - sizeof(BoardPosition);
+      usage.pieces += sizeof(BoardPosition);
+    }
+  };
+  auto addTimeLine = [&usage, &addBoard](const TimeLine& timeLine) {
+    usage.timeLines += sizeof(TimeLine) + timeLine._history.capacity() * sizeof(TimeLine::HistoryEntry)
+                     + timeLine._materialized.capacity() * sizeof(std::pair<int, std::shared_ptr<Board>>);
+    for (const TimeLine::HistoryEntry& entry : timeLine._history) {
+      addBoard(entry.board);
+    }
+    for (const std::pair<int, std::shared_ptr<Board>>& cached : timeLine._materialized) {
+      addBoard(cached.second);
+    }
+  };
+  for (const std::shared_ptr<TimeLine>& timeLine : _timeLines) {
+    addTimeLine(*timeLine);
+  }
+  for (const std::shared_ptr<TimeLine>& timeLine : _timeLinePool) {
+    addTimeLine(*timeLine);
+  }
+  for (const std::shared_ptr<Board>& board : _boardPool) {
+    addBoard(board);
+  }
+  usage.other = sizeof(IGame) + _index.memoryUsage()
+              + _timeLines.capacity() * sizeof(std::shared_ptr<TimeLine>)
+              + _nextHalfTurnBuffer.capacity() * sizeof(int)
+              + _currentTurnMoves.capacity() * sizeof(PackedMove)
+              + _undoBuffer.capacity() * sizeof(UndoRecord)
+              + _turnBuffer.capacity() * sizeof(TurnRecord)
+              + _boardPool.capacity() * sizeof(std::shared_ptr<Board>)
+              + _timeLinePool.capacity() * sizeof(std::shared_ptr<TimeLine>)
+              + _moveable.capacity() * sizeof(u64);
+  usage.arena = _arena->bytesAllocated();
+  return usage;
+}
+
+std::shared_ptr<TimeLine> IGame::_makeTimeLine(int ID, int forkAt) const {
+  std::shared_ptr<TimeLine> timeLine = arenaMakeShared<TimeLine>(_arena, dim(), ID, forkAt, _arena);
+  timeLine->setHistoryMode(_historyMode, _keyframeInterval);
+  return timeLine;
+}
+
+std::shared_ptr<Board> IGame::_makeBoard(std::shared_ptr<TimeLine> timeLine, int halfTurnNumber) const {
+  return arenaMakeShared<Board>(_arena, dim(), timeLine, halfTurnNumber);
 }
 
 std::vector<std::shared_ptr<Board>> IGame::getMoveableBoards(void) const {
   std::vector<std::shared_ptr<Board>> moveableBoards;
-  for (std::shared_ptr<TimeLine> timeLine: _timeLines) {
-    if (timeLine->fullTurnNumber() == presentFullTurn() && timeLine->halfTurnNumber() == _presentHalfTurn) {
-      moveableBoards.push_back(timeLine->back());
+  moveableBoards.reserve(_moveableCount);
+  for (int word = 0; word < int(_moveable.size()); word += 1) {
+    for (u64 bits = _moveable[word]; bits; bits &= bits - 1) {
+      moveableBoards.push_back(_timeLines[word * 64 + std::countr_zero(bits)]->back());
     }
   }
   return moveableBoards;
@@ -68,749 +397,1963 @@ std::vector<std::shared_ptr<Board>> IGame::getMoveableBoards(void) const {
 
 bool IGame::canMakeMoveFromBoard(std::shared_ptr<Board> board) const {
   return board
-    and board->getTimeLine()->fullTurnNumber() == presentFullTurn()
     and board->halfTurnNumber() == _presentHalfTurn
-    and board->getTimeLine()->halfTurnNumber() == _presentHalfTurn;
+    and isMoveable(board->timeLineID());
+}
+
+void MultiverseIndex::addTimeLine(void) {
+  _timeLineCount += 1;
+  _cells.resize(size_t(_timeLineCount) * _stride, nullptr);
+  _valid.resize(_cells.size() / 64, 0);
 }
 
-bool IGame::boardExists(int timeLineID, int halfTurn) const {
-  if (timeLineID >= 0 && timeLineID < _timeLines.size()) {
-    int pos = halfTurn - _timeLines[timeLineID]->forkAt() - 1;
-    return pos >= 0 && pos < _timeLines[timeLineID]->size();
+void MultiverseIndex::removeTimeLine(void) {
+  assert(_timeLineCount > 0);
+  _timeLineCount -= 1;
+  _cells.resize(size_t(_timeLineCount) * _stride);
+  _valid.resize(_cells.size() / 64);
+}
+
+void MultiverseIndex::set(int timeLineID, int halfTurn, Board* board, bool valid) {
+  assert(timeLineID >= 0 && timeLineID < _timeLineCount);
+  assert(halfTurn >= 0);
+  if (halfTurn >= _stride) {
+    _grow(halfTurn + 1);
+  }
+  int cell = timeLineID * _stride + halfTurn;
+  _cells[cell] = board;
+  if (valid) {
+    _valid[cell / 64] |= u64(1) << (cell % 64);
+  } else {
+    _valid[cell / 64] &= ~(u64(1) << (cell % 64));
   }
-  return false;
 }
 
-std::shared_ptr<Piece> IGame::_getPieceByVector4DFullTurn(Vector4D position) const {
-  int x = position.x();
-  int y = position.y();
-  int halfTurn = 2 * position.z() + int(_currentTurnColor);
-  int timeLineID = position.w();
-  assert(timeLineID >= 0 && timeLineID < _timeLines.size());
-  std::shared_ptr<const Board> board = _timeLines[timeLineID]->getBoardByHalfTurn(halfTurn);
-  assert(board != nullptr);
-  assert(x >= 0 && x < board->dim() && y >= 0 && y < board->dim());
-  return board->getPiece(Position2D(x, y));
+void MultiverseIndex::_grow(int minStride) {
+  int stride = std::max(_stride, 64);
+  while (stride < minStride) {
+    stride *= 2;
+  }
+  std::vector<Board*> cells(size_t(_timeLineCount) * stride, nullptr);
+  std::vector<u64> valid(cells.size() / 64, 0);
+  for (int row = 0; row < _timeLineCount; row += 1) {
+    std::copy_n(_cells.begin() + row * _stride, _stride, cells.begin() + row * stride);
+    std::copy_n(_valid.begin() + row * _stride / 64, _stride / 64, valid.begin() + row * stride / 64);
+  }
+  _cells = std::move(cells);
+  _valid = std::move(valid);
+  _stride = stride;
 }
 
-void IGame::undo(void) {
-  assert(undoable());
-  assert(_undoBuffer.size());
-  // Get the last undo operation
-  std::vector<int> lastUndo = _undoBuffer.back();
-  _undoBuffer.pop_back();
+void IGame::_pushBoard(int timeLineID, std::shared_ptr<Board> board) {
+  std::shared_ptr<TimeLine> timeLine = _timeLines[timeLineID];
+  assert(board->timeLineID() == timeLineID);
+  int previousHalfTurn = timeLine->size() > 0 ? timeLine->halfTurnNumber() : -1;
+  if (previousHalfTurn >= 0) {
+    _tipsScore -= tipBoard(timeLineID).score();
+  }
+  _tipsScore += board->score();
+  timeLine->pushBack(board);
+  if (previousHalfTurn >= 0) {
+    // the previous tip may have been reduced to a delta
+    _index.set(timeLineID, previousHalfTurn, timeLine->residentBoard(previousHalfTurn), true);
+  }
+  _index.set(timeLineID, board->halfTurnNumber(), board.get(), true);
+  _boardsHash ^= Zobrist::boardSlotKey(board->hash(), timeLineID, board->halfTurnNumber());
+  // the kings the opponent can capture on the board, boards being popped in the reverse order they are pushed
+  PieceColor color = opposite(PieceColor(board->halfTurnNumber() % 2));
+  for (u64 kings = board->pieceMask(PieceType::PIECEKING, color); kings; kings &= kings - 1) {
+    Position2D king = Board::positionOf(std::countr_zero(kings));
+    _kings[int(color)].push_back(Vector4D(king.x(), king.y(), board->halfTurnNumber() / 2, timeLineID));
+  }
+  _updateMoveable(timeLineID);
+}
 
-  std::reverse(lastUndo.begin(), lastUndo.end());
+void IGame::_popBoard(int timeLineID) {
+  std::shared_ptr<TimeLine> timeLine = _timeLines[timeLineID];
+  std::shared_ptr<Board> board = timeLine->back();
+  _boardsHash ^= Zobrist::boardSlotKey(board->hash(), timeLineID, board->halfTurnNumber());
+  _tipsScore -= board->score();
+  PieceColor color = opposite(PieceColor(board->halfTurnNumber() % 2));
+  std::vector<Vector4D>& kings = _kings[int(color)];
+  kings.erase(kings.end() - std::popcount(board->pieceMask(PieceType::PIECEKING, color)), kings.end());
+  _index.set(timeLineID, board->halfTurnNumber(), nullptr, false);
+  timeLine->popBack();
+  if (timeLine->size() == 0) {
+    assert(int(_timeLines.size()) - 1 == timeLineID);
+    _timeLines.pop_back();
+    _index.removeTimeLine();
+    // only the timelines created by a move are emptied, by undoing that move
+    _timeLineBalance -= _currentTurnColor == PieceColor::PIECEWHITE ? 1 : -1;
+  } else {
+    // the new tip is always resident
+    _index.set(timeLineID, timeLine->halfTurnNumber(), timeLine->back().get(), true);
+    _tipsScore += tipBoard(timeLineID).score();
+  }
+  _updateMoveable(timeLineID);
+}
 
-  for (int timeLineID : lastUndo) {
-    _timeLines[timeLineID]->popBack();
-    if (_timeLines[timeLineID]->size() == 0) {
-      assert(_timeLines.size() - 1 == timeLineID);
-      _timeLines.pop_back();
+void IGame::setHistoryMode(HistoryMode mode, int keyframeInterval) {
+  _historyMode = mode;
+  _keyframeInterval = keyframeInterval;
+  for (std::shared_ptr<TimeLine>& timeLine : _timeLines) {
+    timeLine->setHistoryMode(mode, keyframeInterval);
+    for (int pos = 0; pos < timeLine->size(); pos += 1) {
+      int halfTurn = timeLine->forkAt() + 1 + pos;
+      _index.set(timeLine->ID(), halfTurn, timeLine->residentBoard(halfTurn), true);
     }
   }
+}
 
+void IGame::undoMove(void) {
+  assert(undoable());
+  UndoRecord record = _undoBuffer.back();
+  _undoBuffer.pop_back();
+  if (record.toTimeLine >= 0) {
+    _recycleTip(record.toTimeLine);
+  }
+  _recycleTip(record.move.fromTimeLine());
+  // a captured king ended the game, bring it back to life
+  if (record.endedGame) {
+    _gameWinner.reset();
+  }
   _currentTurnMoves.pop_back();
   _nextHalfTurnBuffer.pop_back();
 }
 
-std::vector<Vector4D> genKnightMoves(const Vector4D& from) {
-  std::vector<Vector4D> moves;
-  moves.reserve(48);
-
-  const int x = from.x();
-  const int y = from.y();
-  const int z = from.z();
-  const int w = from.w();
-
-  auto build = [&] (int axis2, int axis1, int s2, int s1) {
-    int nx = x, ny = y, nz = z, nw = w;
+std::shared_ptr<Board> IGame::_forkBoard(const Board& parent, const std::shared_ptr<TimeLine>& timeLine) {
+  std::shared_ptr<Board> board;
+  if (_boardPool.empty()) {
+    board = _makeBoard(timeLine, parent.halfTurnNumber() + 1);
+  } else {
+    board = std::move(_boardPool.back());
+    _boardPool.pop_back();
+  }
+  board->_forkFrom(parent, timeLine);
+  return board;
+}
 
-    switch (axis2) {
-      case 0: nx += 2 * s2; break;
-      case 1: ny += 2 * s2; break;
-      case 2: nz += 2 * s2; break;
-      case 3: nw += 2 * s2; break;
-    }
+std::shared_ptr<TimeLine> IGame::_forkTimeLine(int parentID, int forkAt) {
+  if (_timeLinePool.empty()) {
+    return _timeLines[parentID]->createFork(_timeLines.size(), forkAt);
+  }
+  std::shared_ptr<TimeLine> timeLine = std::move(_timeLinePool.back());
+  _timeLinePool.pop_back();
+  timeLine->_forkFrom(_timeLines[parentID], _timeLines.size(), forkAt);
+  return timeLine;
+}
 
-    switch (axis1) {
-      case 0: nx += 1 * s1; break;
-      case 1: ny += 1 * s1; break;
-      case 2: nz += 1 * s1; break;
-      case 3: nw += 1 * s1; break;
-    }
+void IGame::_recycleTip(int timeLineID) {
+  std::shared_ptr<TimeLine> timeLine = _timeLines[timeLineID];
+  std::shared_ptr<Board> board = timeLine->back();
+  _popBoard(timeLineID);
+  // objects still referenced elsewhere (the renderer, a rebuilt-board cache) are left to their owners
+  if (board.use_count() > 1) {
+    return;
+  }
+  _boardPool.push_back(std::move(board));
+  // boards only know their timeline by ID, reusing it is safe once nothing else holds it
+  if (timeLine->size() == 0 and timeLine.use_count() == 1) {
+    timeLine->_parent.reset();
+    _timeLinePool.push_back(std::move(timeLine));
+  }
+}
 
-    Vector4D to = Vector4D(nx, ny, nz, nw);
+/**
+ * Get the squares reachable by sliding on a board of a fixed size.
+ * Same result as Board::rayMask, with the size and direction known at compile time so the loop fully unrolls.
+ */
+template<int N, int DX, int DY>
+static inline u64 slidingRay(u64 occupied, Position2D from) {
+  u64 ray = 0;
+  int x = from.x() + DX;
+  int y = from.y() + DY;
+  for (int step = 1; step < N; step += 1, x += DX, y += DY) {
+    if (unsigned(x) >= unsigned(N) or unsigned(y) >= unsigned(N)) break;
+    u64 bit = u64(1) << (x * Board::MAX_DIM + y);
+    ray |= bit;
+    if (occupied & bit) break;
+  }
+  return ray;
+}
 
-    moves.push_back(to);
-  };
+IGame::MoveGenerator IGame::_selectMoveGenerator(int N) {
+  switch (N) {
+    case 1: return &IGame::_generateMoves<1>;
+    case 2: return &IGame::_generateMoves<2>;
+    case 3: return &IGame::_generateMoves<3>;
+    case 4: return &IGame::_generateMoves<4>;
+    case 5: return &IGame::_generateMoves<5>;
+    case 6: return &IGame::_generateMoves<6>;
+    case 7: return &IGame::_generateMoves<7>;
+    case 8: return &IGame::_generateMoves<8>;
+  }
+  throw std::invalid_argument("Unsupported board size");
+}
 
-  for (int axis2 = 0; axis2 < 4; axis2 += 1) {
-    for (int axis1 = 0; axis1 < 4; axis1 += 1) {
-      if (axis1 == axis2) continue;
-      for (int s2 : {-1, 1}) {
-        for (int s1 : {-1, 1}) {
-          build(axis2, axis1, s2, s1);
-        }
-      }
-    }
+std::vector<SelectedPosition> IGame::getMoveablePositions(SelectedPosition selected, MoveFilter filter) const {
+  std::array<MoveTarget, 256> buffer;
+  std::vector<MoveTarget> largeBuffer;
+  std::span<MoveTarget> targets = buffer;
+  int count = getMoveablePositions(selected, targets, filter);
+  if (count > int(targets.size())) {
+    largeBuffer.resize(count);
+    targets = largeBuffer;
+    getMoveablePositions(selected, targets, filter);
   }
 
-  return moves;
+  std::vector<SelectedPosition> moveablePositions;
+  moveablePositions.reserve(count);
+  for (const MoveTarget& target : targets.first(count)) {
+    moveablePositions.push_back(toSelectedPosition(target));
+  }
+  return moveablePositions;
 }
 
-std::vector<SelectedPosition> IGame::getMoveablePositions(SelectedPosition selected) const {
-  std::shared_ptr<const Piece> piece = selected.board->getPiece(selected.position);
-  Vector4D from = selected.toVector4D();
-  int parity = int(_currentTurnColor);
-  std::vector<SelectedPosition> moveablePositions;
+int IGame::getMoveablePositions(const SelectedPosition& selected, std::span<MoveTarget> targets, MoveFilter filter) const {
+  PieceCode piece = selected.board->pieceAt(selected.position);
 
-  if (piece == nullptr) {
+  if (piece == EMPTY_SQUARE) {
     throw std::runtime_error("No piece at selected position");
   }
 
-  if (piece->color() != _currentTurnColor) {
+  if (pieceColorOf(piece) != _currentTurnColor) {
     throw std::runtime_error("Piece color does not match current turn color");
   }
 
-  if (piece->name() == "rook") {
-    for (int nx = from.x() + 1; nx < dim(); nx += 1) {
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({nx, from.y(), from.z(), from.w()});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
-      }
-      moveablePositions.emplace_back(selected.board, Position2D(nx, from.y()));
-      if (targetPiece != nullptr)
-        break;
-    }
+  _MoveTargetWriter writer{targets};
+  writer.game = this;
+  writer.fromTimeLine = selected.board->timeLineID();
+  writer.fromHalfTurn = selected.board->halfTurnNumber();
+  writer.from = selected.position;
+  writer.piece = piece;
+  writer.nearLimits = _nearPackedLimits();
+  if (filter == MoveFilter::LEGAL) {
+    _prepareLegality();
+    writer.legalOnly = true;
+  }
+  (this->*_moveGenerator)(*selected.board, selected.toVector4D(), piece, writer);
+  return writer.count;
+}
 
-    for (int nx = from.x() - 1; nx >= 0; nx -= 1) {
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({nx, from.y(), from.z(), from.w()});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
-      }
-      moveablePositions.emplace_back(selected.board, Position2D(nx, from.y()));
-      if (targetPiece != nullptr)
-        break;
+bool IGame::_nearPackedLimits(void) const {
+  if (int(_timeLines.size()) >= PackedMove::MAX_TIMELINES) {
+    return true;
+  }
+  // moves start from tips and land on existing boards, so the latest tip bounds the boards they make
+  for (const std::shared_ptr<TimeLine>& timeLine : _timeLines) {
+    if (timeLine->halfTurnNumber() + 1 >= PackedMove::MAX_HALF_TURNS) return true;
+  }
+  return false;
+}
+
+int IGame::generateAllMoves(MoveBuffer& moves, MoveFilter filter) const {
+  int pushedBefore = moves.pushed();
+  _MoveTargetWriter writer;
+  writer.moves = &moves;
+  writer.game = this;
+  writer.nearLimits = _nearPackedLimits();
+  if (filter == MoveFilter::LEGAL) {
+    _prepareLegality();
+    writer.legalOnly = true;
+  }
+  for (int word = 0; word < int(_moveable.size()); word += 1) {
+    for (u64 bits = _moveable[word]; bits; bits &= bits - 1) {
+      _generateBoardMoves(*_timeLines[word * 64 + std::countr_zero(bits)], writer);
     }
+  }
+  return moves.pushed() - pushedBefore;
+}
 
-    for (int ny = from.y() + 1; ny < dim(); ny += 1) {
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), ny, from.z(), from.w()});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
+int IGame::generateMoves(int timeLineID, MoveBuffer& moves, MoveFilter filter) const {
+  assert(isMoveable(timeLineID));
+  int pushedBefore = moves.pushed();
+  _MoveTargetWriter writer;
+  writer.moves = &moves;
+  writer.game = this;
+  writer.nearLimits = _nearPackedLimits();
+  if (filter == MoveFilter::LEGAL) {
+    _prepareLegality();
+    writer.legalOnly = true;
+  }
+  _generateBoardMoves(*_timeLines[timeLineID], writer);
+  return moves.pushed() - pushedBefore;
+}
+
+void IGame::_generateBoardMoves(const TimeLine& timeLine, _MoveTargetWriter& writer) const {
+  const Board& board = *_boardAt(timeLine.ID(), timeLine.halfTurnNumber());
+  writer.fromTimeLine = timeLine.ID();
+  writer.fromHalfTurn = board.halfTurnNumber();
+  for (const PlacedPiece& placed : board.pieces(_currentTurnColor)) {
+    writer.from = placed.position;
+    writer.piece = placed.code;
+    Vector4D from(placed.position.x(), placed.position.y(), board.fullTurnNumber(), timeLine.ID());
+    (this->*_moveGenerator)(board, from, placed.code, writer);
+  }
+}
+
+bool IGame::isLegal(PackedMove move) const {
+  _prepareLegality();
+  PieceCode piece = _boardAt(move.fromTimeLine(), move.fromHalfTurn())->pieceAt(move.from());
+  return _isLegal(move.fromTimeLine(), move.fromHalfTurn(), move.from(), piece, move.toTimeLine(), move.toHalfTurn(), move.to());
+}
+
+/**
+ * Get the piece that lands on the target square of a move.
+ * Pawns reaching the last rank are promoted to queens.
+ */
+static PieceCode landingPiece(PieceCode piece, Position2D to, int N) {
+  if (to.y() == 0 and piece == BLACK_PAWN) {
+    return BLACK_QUEEN;
+  }
+  if (to.y() == N - 1 and piece == WHITE_PAWN) {
+    return WHITE_QUEEN;
+  }
+  return piece;
+}
+
+static constexpr int BOARD_RAYS[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+/**
+ * The squares of each of the eight BOARD_RAYS from each square, to the edge of the largest board.
+ */
+static constexpr auto RAY_SQUARES = []() {
+  std::array<std::array<u64, 8>, Board::MAX_DIM * Board::MAX_DIM> rays{};
+  for (int square = 0; square < Board::MAX_DIM * Board::MAX_DIM; square += 1) {
+    for (int ray = 0; ray < 8; ray += 1) {
+      int dx = BOARD_RAYS[ray][0], dy = BOARD_RAYS[ray][1];
+      for (int x = square / Board::MAX_DIM + dx, y = square % Board::MAX_DIM + dy;
+           unsigned(x) < unsigned(Board::MAX_DIM) and unsigned(y) < unsigned(Board::MAX_DIM); x += dx, y += dy) {
+        rays[square][ray] |= u64(1) << (x * Board::MAX_DIM + y);
       }
-      moveablePositions.emplace_back(selected.board, Position2D(from.x(), ny));
-      if (targetPiece != nullptr)
-        break;
     }
-
-    for (int ny = from.y() - 1; ny >= 0; ny -= 1) {
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), ny, from.z(), from.w()});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
+  }
+  return rays;
+}();
+
+/**
+ * Get the squares leaps of the given offsets reach from each square without leaving the largest board.
+ */
+static constexpr std::array<u64, Board::MAX_DIM * Board::MAX_DIM> boardLeaps(const std::array<std::array<int, 2>, 8>& offsets) {
+  std::array<u64, Board::MAX_DIM * Board::MAX_DIM> leaps{};
+  for (int square = 0; square < Board::MAX_DIM * Board::MAX_DIM; square += 1) {
+    for (const std::array<int, 2>& offset : offsets) {
+      int x = square / Board::MAX_DIM + offset[0], y = square % Board::MAX_DIM + offset[1];
+      if (unsigned(x) < unsigned(Board::MAX_DIM) and unsigned(y) < unsigned(Board::MAX_DIM)) {
+        leaps[square] |= u64(1) << (x * Board::MAX_DIM + y);
       }
-      moveablePositions.emplace_back(selected.board, Position2D(from.x(), ny));
-      if (targetPiece != nullptr)
-        break;
     }
+  }
+  return leaps;
+}
 
-    for (int nz = from.z() - 1; nz >= 0; nz -= 1) {
-      if (not boardExists(from.w(), 2 * nz + parity)) {
-        break;
-      }
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), from.y(), nz, from.w()});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
+static constexpr auto KNIGHT_SQUARES = boardLeaps({{{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}}});
+static constexpr auto KING_SQUARES = boardLeaps({{{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}}});
+
+/**
+ * The squares a slide can start from to reach a square `distance` boards away, per square and distance: the square
+ * itself and the squares `distance` steps away along the eight directions of the board.
+ */
+static constexpr auto SLIDE_SOURCES = []() {
+  std::array<std::array<u64, Board::MAX_DIM>, Board::MAX_DIM * Board::MAX_DIM> sources{};
+  for (int x = 0; x < Board::MAX_DIM; x += 1) {
+    for (int y = 0; y < Board::MAX_DIM; y += 1) {
+      for (int distance = 1; distance < Board::MAX_DIM; distance += 1) {
+        for (int stepX = -1; stepX <= +1; stepX += 1) {
+          for (int stepY = -1; stepY <= +1; stepY += 1) {
+            int fromX = x - distance * stepX, fromY = y - distance * stepY;
+            if (unsigned(fromX) >= unsigned(Board::MAX_DIM) or unsigned(fromY) >= unsigned(Board::MAX_DIM)) continue;
+            sources[x * Board::MAX_DIM + y][distance] |= u64(1) << (fromX * Board::MAX_DIM + fromY);
+          }
+        }
       }
-      moveablePositions.emplace_back(getBoard(from.w(), 2 * nz + parity), Position2D(from.x(), from.y()));
-      if (targetPiece != nullptr)
-        break;
     }
-
-    for (int nw = from.w() - 1; nw >= 0; nw -= 1) {
-      if (not boardExists(nw, 2 * from.z() + parity)) {
+  }
+  return sources;
+}();
+
+/**
+ * The squares within two files and two ranks of each square, the only ones a leap to it can start from.
+ */
+static constexpr auto LEAP_SOURCES = []() {
+  std::array<u64, Board::MAX_DIM * Board::MAX_DIM> sources{};
+  for (int square = 0; square < Board::MAX_DIM * Board::MAX_DIM; square += 1) {
+    for (int from = 0; from < Board::MAX_DIM * Board::MAX_DIM; from += 1) {
+      int dx = square / Board::MAX_DIM - from / Board::MAX_DIM, dy = square % Board::MAX_DIM - from % Board::MAX_DIM;
+      if (std::abs(dx) <= 2 and std::abs(dy) <= 2) sources[square] |= u64(1) << from;
+    }
+  }
+  return sources;
+}();
+
+/**
+ * Find the pieces of the attacker checking a king on its own board, and the defender's pieces pinned to it.
+ * @param board The board of the king.
+ * @param king The square of the king.
+ * @param attacker The color of the attacking pieces.
+ * @param checkMask Intersected with the squares a move must land on to stop each check (the checker or the squares between).
+ * @param pinned Receives the pinned pieces.
+ * @param pinLine Intersected, for each pinned piece, with the squares it may move to without leaving the pin line.
+ */
+static void analyzeKingOnBoard(const Board& board, Position2D king, PieceColor attacker, u64& checkMask, u64& pinned, std::array<u64, 64>& pinLine) {
+  int N = board.dim();
+  int kingSquare = Board::squareOf(king);
+  u64 own = board.colorMask(opposite(attacker));
+  u64 enemy = board.colorMask(attacker);
+  for (int ray = 0; ray < 8; ray += 1) {
+    int dx = BOARD_RAYS[ray][0], dy = BOARD_RAYS[ray][1];
+    u64 sliders = board.pieceMask(PieceType::PIECEQUEEN, attacker)
+                | board.pieceMask(ray < 4 ? PieceType::PIECEROOK : PieceType::PIECEBISHOP, attacker);
+    // most rays hold no slider that could check or pin along them
+    if (not (sliders & RAY_SQUARES[kingSquare][ray])) continue;
+    u64 squares = 0;
+    int blocker = -1;
+    for (int x = king.x() + dx, y = king.y() + dy; x >= 0 && x < N && y >= 0 && y < N; x += dx, y += dy) {
+      int square = Board::squareOf(Position2D(x, y));
+      u64 bit = u64(1) << square;
+      squares |= bit;
+      if (enemy & bit) {
+        if (sliders & bit) {
+          if (blocker < 0) {
+            checkMask &= squares;
+          } else {
+            pinned |= u64(1) << blocker;
+            pinLine[blocker] &= squares;
+          }
+        }
         break;
       }
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), from.y(), from.z(), nw});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
+      if (own & bit) {
+        if (blocker >= 0) break;
+        blocker = square;
       }
-      moveablePositions.emplace_back(getBoard(nw, 2 * from.z() + parity), Position2D(from.x(), from.y()));
-      if (targetPiece != nullptr)
-        break;
     }
+  }
 
-    for (int nw = from.w() + 1; nw < _timeLines.size(); nw += 1) {
-      if (not boardExists(nw, 2 * from.z() + parity)) {
-        break;
-      }
-      std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), from.y(), from.z(), nw});
-      if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-        break;
-      }
-      moveablePositions.emplace_back(getBoard(nw, 2 * from.z() + parity), Position2D(from.x(), from.y()));
-      if (targetPiece != nullptr)
-        break;
+  // leapers and pawns cannot be blocked, only captured
+  u64 leapers = (board.pieceMask(PieceType::PIECEKNIGHT, attacker) & KNIGHT_SQUARES[kingSquare])
+              | (board.pieceMask(PieceType::PIECEKING, attacker) & KING_SQUARES[kingSquare]);
+  for (; leapers; leapers &= leapers - 1) {
+    checkMask &= leapers & -leapers;
+  }
+  auto checkFrom = [&](int dx, int dy, PieceType type) {
+    int x = king.x() + dx, y = king.y() + dy;
+    if (x < 0 or x >= N or y < 0 or y >= N) return;
+    u64 bit = u64(1) << Board::squareOf(Position2D(x, y));
+    if (board.pieceMask(type, attacker) & bit) {
+      checkMask &= bit;
     }
+  };
+  int pawnStep = attacker == PieceColor::PIECEWHITE ? +1 : -1;
+  checkFrom(-1, -pawnStep, PieceType::PIECEPAWN);
+  checkFrom(+1, -pawnStep, PieceType::PIECEPAWN);
+}
+
+/**
+ * Check whether a board can be on a line to a king at all: lines run along the time and timeline axes or diagonally
+ * between them, and leaps reach the boards at most two away.
+ */
+static inline bool mayLineUp(const Vector4D& king, int timeLine, int halfTurn) {
+  int dz = king.z() - halfTurn / 2, dw = king.w() - timeLine;
+  return (std::abs(dz) <= 2 and std::abs(dw) <= 2) or dz == 0 or dw == 0 or std::abs(dz) == std::abs(dw);
+}
+
+/**
+ * Check whether one slide can pass two boards on its way to a king, which it only does leaving the king in one direction.
+ */
+static inline bool maySlideThrough(const Vector4D& king, int timeLine0, int halfTurn0, int timeLine1, int halfTurn1) {
+  int dz0 = king.z() - halfTurn0 / 2, dw0 = king.w() - timeLine0;
+  int dz1 = king.z() - halfTurn1 / 2, dw1 = king.w() - timeLine1;
+  auto aligned = [](int dz, int dw) { return dz == 0 or dw == 0 or std::abs(dz) == std::abs(dw); };
+  auto sign = [](int value) { return (value > 0) - (value < 0); };
+  return aligned(dz0, dw0) and aligned(dz1, dw1) and sign(dz0) == sign(dz1) and sign(dw0) == sign(dw1);
+}
+
+/**
+ * The pieces of the attacker on a board that may attack a king on another board, see mayAttack.
+ */
+struct BoardAttackers {
+  u64 leapers = 0;
+  u64 sliders = 0;
+
+  BoardAttackers(const Board& board, PieceColor attacker)
+    : leapers(board.pieceMask(PieceType::PIECEKNIGHT, attacker) | board.pieceMask(PieceType::PIECEKING, attacker)),
+      sliders(board.pieceMask(PieceType::PIECEQUEEN, attacker) | board.pieceMask(PieceType::PIECEROOK, attacker)
+              | board.pieceMask(PieceType::PIECEBISHOP, attacker)) {}
+};
+
+/**
+ * Check whether a piece of the attacker on a board could reach a king on another board, blockers and missing boards
+ * aside, which is every attack _constrainKing can find from that board.
+ */
+static inline bool mayAttack(const BoardAttackers& attackers, int timeLine, int halfTurn, const Vector4D& king) {
+  int fullTurn = halfTurn / 2;
+  int dz = std::abs(king.z() - fullTurn), dw = std::abs(king.w() - timeLine);
+  if (dz == 0 and dw == 0) return false;
+  int kingSquare = Board::squareOf(Position2D(king.x(), king.y()));
+  if (dz <= 2 and dw <= 2 and (attackers.leapers & LEAP_SOURCES[kingSquare])) {
+    return true;
   }
+  int distance = std::max(dz, dw);
+  if ((dz != 0 and dz != distance) or (dw != 0 and dw != distance) or (dz != 0 and distance > fullTurn)) {
+    return false;
+  }
+  return attackers.sliders & (distance < Board::MAX_DIM ? SLIDE_SOURCES[kingSquare][distance] : u64(1) << kingSquare);
+}
 
-  if (piece->name() == "knight") {
-    std::vector<Vector4D> knightMoves = genKnightMoves(from);
+void IGame::_constrainKing(Vector4D king, PieceColor attacker, const _Overlay& overlay, int pivot, bool canFill, bool canVacate,
+                           _LineFilter filter, _MoveConstraints& constraints) const {
+  int parity = int(attacker);
+  int pivotTimeLine = pivot >= 0 ? overlay[pivot].timeLine : -1;
+  int pivotHalfTurn = pivot >= 0 ? overlay[pivot].halfTurn : -1;
 
-    for (const Vector4D& move : knightMoves) {
-      if (move.x() >= 0 && move.x() < dim() && move.y() >= 0 && move.y() < dim()) {
-        if (boardExists(move.w(), 2 * move.z() + parity)
-            && (_getPieceByVector4DFullTurn(move) == nullptr || _getPieceByVector4DFullTurn(move)->color() != _currentTurnColor)) {
-          moveablePositions.emplace_back(getBoard(move.w(), 2 * move.z() + parity), Position2D(move.x(), move.y()));
-        }
+  auto lookup = [&](int timeLine, int halfTurn) -> const Board* {
+    for (const _VirtualBoard& added : overlay) {
+      if (added.board != nullptr and added.timeLine == timeLine and added.halfTurn == halfTurn) return added.board;
+    }
+    return _boardAt(timeLine, halfTurn);
+  };
+
+  // whether the line from a piece `distance` steps away to the king passes a board, the board of the piece included
+  auto touches = [&](const Offset4D& step, int distance, int timeLine, int halfTurn) {
+    for (int k = 1; k <= distance; k += 1) {
+      if (king.w() - k * step.w == timeLine and 2 * (king.z() - k * step.z) + parity == halfTurn) return true;
+    }
+    return false;
+  };
+
+  auto wanted = [&](const Offset4D& step, int distance) {
+    switch (filter) {
+    case _LineFilter::ALL: return true;
+    case _LineFilter::PIVOT: return touches(step, distance, pivotTimeLine, pivotHalfTurn);
+    case _LineFilter::OVERLAY:
+      return touches(step, distance, overlay[0].timeLine, overlay[0].halfTurn)
+         and touches(step, distance, overlay[1].timeLine, overlay[1].halfTurn);
+    }
+    return true;
+  };
+
+  if (filter == _LineFilter::PIVOT and not mayLineUp(king, pivotTimeLine, pivotHalfTurn)) return;
+  if (filter == _LineFilter::OVERLAY
+      and not maySlideThrough(king, overlay[0].timeLine, overlay[0].halfTurn, overlay[1].timeLine, overlay[1].halfTurn)) return;
+
+  // the line stays open unless the move vacates nothing it needs on the first board, or fills a square of it on the second
+  auto foldAcrossOverlay = [&](const Offset4D& step, int distance) {
+    u64 from = ~u64(0), to = 0;
+    for (int k = 1; k <= distance; k += 1) {
+      int halfTurn = 2 * (king.z() - k * step.z) + parity;
+      int timeLine = king.w() - k * step.w;
+      const Board* board = lookup(timeLine, halfTurn);
+      if (board == nullptr) return;
+      Position2D position(king.x() - k * step.x, king.y() - k * step.y);
+      u64 bit = u64(1) << Board::squareOf(position);
+      bool vacated = timeLine == overlay[0].timeLine and halfTurn == overlay[0].halfTurn;
+      bool filled = timeLine == overlay[1].timeLine and halfTurn == overlay[1].halfTurn;
+      if (k == distance) {
+        // the attacker can be captured on the second board only
+        if (filled) to = bit;
+      } else if (vacated and board->colorAt(position) == std::optional<PieceColor>(opposite(attacker))) {
+        from = bit;
+      } else if (board->isOccupied(position)) {
+        return;
+      } else if (filled) {
+        to = bit;
       }
     }
-  }
+    if (from == ~u64(0)) {
+      constraints.requiredTo &= to;
+    } else if (to == 0) {
+      constraints.forbiddenFrom |= from;
+    } else if (constraints.clauseCount < int(constraints.clauses.size())) {
+      constraints.clauses[constraints.clauseCount++] = _MoveConstraints::Clause{from, to};
+    } else {
+      constraints.exact = true;
+    }
+  };
 
-  if (piece->name() == "bishop") {
-    for (int sx : {-1, +1}) for (int sy : {-1, +1}) {
-      for (int d = 1; d < dim(); d += 1) {
-        int nx = from.x() + sx * d;
-        int ny = from.y() + sy * d;
-        if (nx < 0 || nx >= dim() || ny < 0 || ny >= dim()) break;
-        std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({nx, ny, from.z(), from.w()});
-        if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-          break;
-        }
-        moveablePositions.emplace_back(selected.board, Position2D(nx, ny));
-        if (targetPiece != nullptr) {
-          break;
-        }
+  // folds the line from an attacker `distance` steps away into the constraints
+  auto fold = [&](const Offset4D& step, int distance) {
+    if (not wanted(step, distance)) return;
+    if (filter == _LineFilter::OVERLAY) {
+      foldAcrossOverlay(step, distance);
+      return;
+    }
+
+    int crossed = -1;
+    PieceCode crossedPiece = EMPTY_SQUARE;
+    for (int k = 1; k < distance; k += 1) {
+      int halfTurn = 2 * (king.z() - k * step.z) + parity;
+      int timeLine = king.w() - k * step.w;
+      const Board* board = lookup(timeLine, halfTurn);
+      if (board == nullptr) return;
+      Position2D position(king.x() - k * step.x, king.y() - k * step.y);
+      if (timeLine == pivotTimeLine and halfTurn == pivotHalfTurn) {
+        crossed = Board::squareOf(position);
+        crossedPiece = board->pieceAt(position);
+      } else if (board->isOccupied(position)) {
+        return;
       }
     }
 
-    for (int sx : {-1, +1}) {
-      for (int d = 1; d < dim(); d += 1) {
-        int nx = from.x() + sx * d;
-        int nz = from.z() - d;
-        if (nz < 0) break;
-        if (nx < 0 || nx >= dim()) break;
-        if (!boardExists(from.w(), 2 * nz + parity)) break;
-        std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({nx, from.y(), nz, from.w()});
-        if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-          break;
-        }
-        moveablePositions.emplace_back(getBoard(from.w(), 2 * nz + parity), Position2D(nx, from.y()));
-        if (targetPiece != nullptr) {
-          break;
-        }
+    int sourceTimeLine = king.w() - distance * step.w;
+    int sourceHalfTurn = 2 * (king.z() - distance * step.z) + parity;
+    if (sourceTimeLine == pivotTimeLine and sourceHalfTurn == pivotHalfTurn) {
+      // the attacker stands on the pivot board, only capturing it helps
+      crossed = Board::squareOf(Position2D(king.x() - distance * step.x, king.y() - distance * step.y));
+      crossedPiece = EMPTY_SQUARE;
+    }
+    if (crossed < 0) {
+      constraints.impossible = true;
+    } else if (crossedPiece == EMPTY_SQUARE) {
+      if (canFill) {
+        constraints.requiredTo &= u64(1) << crossed;
+      } else {
+        constraints.impossible = true;
       }
+    } else if (pieceColorOf(crossedPiece) != attacker and canVacate) {
+      constraints.forbiddenFrom |= u64(1) << crossed;
     }
+  };
 
-    for (int sy : {-1, +1}) {
-      for (int d = 1; d < dim(); d += 1) {
-        int ny = from.y() + sy * d;
-        int nz = from.z() - d;
-        if (nz < 0) break;
-        if (ny < 0 || ny >= dim()) break;
-        if (!boardExists(from.w(), 2 * nz + parity)) break;
-        std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), ny, nz, from.w()});
-        if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-          break;
-        }
-        moveablePositions.emplace_back(getBoard(from.w(), 2 * nz + parity), Position2D(from.x(), ny));
-        if (targetPiece != nullptr) {
-          break;
+  // every attack line ends on a board the attacker moves from, the offset to that board fixes the possible directions
+  int kingSquare = Board::squareOf(Position2D(king.x(), king.y()));
+  auto scanFrom = [&](const Board& tip, int tipTimeLine, int tipHalfTurn) {
+    int tipFullTurn = tipHalfTurn / 2;
+    int dz = king.z() - tipFullTurn, dw = king.w() - tipTimeLine;
+    if (dz == 0 and dw == 0) return;
+
+    // the leaps of Directions::KNIGHT are the offsets of squared length 5, the steps of Directions::KING those within one square not going forward in time
+    if (std::abs(dz) <= 2 and std::abs(dw) <= 2) {
+      u64 knights = tip.pieceMask(PieceType::PIECEKNIGHT, attacker);
+      for (u64 leapers = (knights | tip.pieceMask(PieceType::PIECEKING, attacker)) & LEAP_SOURCES[kingSquare]; leapers; leapers &= leapers - 1) {
+        int square = std::countr_zero(leapers);
+        Position2D position = Board::positionOf(square);
+        int leapX = king.x() - position.x(), leapY = king.y() - position.y();
+        int length = leapX * leapX + leapY * leapY + dz * dz + dw * dw;
+        bool step = std::max({std::abs(leapX), std::abs(leapY), std::abs(dz), std::abs(dw)}) == 1 and dz <= 0;
+        if ((knights >> square & 1) ? length == 5 : step) {
+          fold(Offset4D{int8_t(leapX), int8_t(leapY), int8_t(dz), int8_t(dw)}, 1);
         }
       }
     }
 
-    for (int sx : {-1, +1}) for (int sw : {-1, +1}) {
-      for (int d = 1; d < dim(); d += 1) {
-        int nx = from.x() + sx * d;
-        int nw = from.w() + sw * d;
-        if (nx < 0 || nx >= dim()) break;
-        if (!boardExists(nw, 2 * from.z() + parity)) break;
-        std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({nx, from.y(), from.z(), nw});
-        if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-          break;
-        }
-        moveablePositions.emplace_back(getBoard(nw, 2 * from.z() + 1), Position2D(nx, from.y()));
-        if (targetPiece != nullptr) {
-          break;
-        }
+    int distance = std::max(std::abs(dz), std::abs(dw));
+    if ((dz != 0 and std::abs(dz) != distance) or (dw != 0 and std::abs(dw) != distance)) return;
+    int8_t stepZ = (dz > 0) - (dz < 0), stepW = (dw > 0) - (dw < 0);
+    // a slide across turns covers at most as many turns as its board has behind it
+    if (stepZ != 0 and distance > tipFullTurn) return;
+    u64 sliders = tip.pieceMask(PieceType::PIECEQUEEN, attacker) | tip.pieceMask(PieceType::PIECEROOK, attacker)
+                | tip.pieceMask(PieceType::PIECEBISHOP, attacker);
+    sliders &= distance < Board::MAX_DIM ? SLIDE_SOURCES[kingSquare][distance] : u64(1) << kingSquare;
+    if (sliders == 0 or not wanted(Offset4D{0, 0, stepZ, stepW}, distance)) return;
+    for (; sliders; sliders &= sliders - 1) {
+      int square = std::countr_zero(sliders);
+      Position2D position = Board::positionOf(square);
+      int8_t stepX = (king.x() - position.x()) / distance, stepY = (king.y() - position.y()) / distance;
+      // rooks take the directions along one axis and bishops those along two, neither of them moving into the future
+      int axes = (stepX != 0) + (stepY != 0) + (stepZ != 0) + (stepW != 0);
+      PieceType type = pieceTypeOf(tip.pieceAt(position));
+      if (type == PieceType::PIECEQUEEN
+          or (type == PieceType::PIECEROOK and axes == 1 and stepZ <= 0)
+          or (type == PieceType::PIECEBISHOP and axes == 2 and stepZ <= 0)) {
+        fold(Offset4D{stepX, stepY, stepZ, stepW}, distance);
       }
     }
+  };
 
-    for (int sy : {-1, +1}) for (int sw : {-1, +1}) {
-      for (int d = 1; d < dim(); d += 1) {
-        int ny = from.y() + sy * d;
-        int nw = from.w() + sw * d;
-        if (ny < 0 || ny >= dim()) break;
-        if (!boardExists(nw, 2 * from.z() + parity)) break;
-        std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), ny, from.z(), nw});
-        if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-          break;
-        }
-        moveablePositions.emplace_back(getBoard(nw, 2 * from.z() + 1), Position2D(from.x(), ny));
-        if (targetPiece != nullptr) {
-          break;
+  auto scanTip = [&](int timeLine) {
+    const TimeLine& line = *_timeLines[timeLine];
+    if (line.halfTurnNumber() % 2 == parity) {
+      scanFrom(*_boardAt(timeLine, line.halfTurnNumber()), timeLine, line.halfTurnNumber());
+    }
+  };
+  if (filter == _LineFilter::ALL) {
+    for (int timeLine = 0; timeLine < int(_timeLines.size()) and not constraints.impossible; timeLine += 1) {
+      scanTip(timeLine);
+    }
+  } else {
+    // the lines wanted pass the pivot board, so their attackers stand on it or beyond it seen from the king
+    const _VirtualBoard& anchor = overlay[pivot >= 0 ? pivot : 0];
+    int dz = king.z() - anchor.halfTurn / 2, dw = king.w() - anchor.timeLine;
+    if (dz == 0 or dw == 0 or std::abs(dz) == std::abs(dw)) {
+      int stepZ = (dz > 0) - (dz < 0), stepW = (dw > 0) - (dw < 0);
+      if (stepW == 0) {
+        scanTip(king.w());
+      } else {
+        for (int k = std::max(std::abs(dz), std::abs(dw)); not constraints.impossible; k += 1) {
+          int timeLine = king.w() - k * stepW, fullTurn = king.z() - k * stepZ;
+          if (timeLine < 0 or timeLine >= int(_timeLines.size()) or fullTurn < 0) break;
+          if (_timeLines[timeLine]->halfTurnNumber() == 2 * fullTurn + parity) {
+            scanTip(timeLine);
+          }
         }
       }
+    } else if (anchor.timeLine < int(_timeLines.size())) {
+      // only a leap touches a board off the lines of the king, from that very board
+      scanTip(anchor.timeLine);
     }
+  }
+  for (const _VirtualBoard& added : overlay) {
+    if (constraints.impossible) return;
+    if (added.board != nullptr) {
+      scanFrom(*added.board, added.timeLine, added.halfTurn);
+    }
+  }
+}
 
-    for (int sw : {-1, +1}) {
-      for (int d = 1; d <= selected.board->fullTurnNumber(); d += 1) {
-        int nz = from.z() - d;
-        int nw = from.w() + sw * d;
-        if (!boardExists(nw, 2 * nz + parity)) break;
-        std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({from.x(), from.y(), nz, nw});
-        if (targetPiece != nullptr and targetPiece->color() == _currentTurnColor) {
-          break;
-        }
-        moveablePositions.emplace_back(getBoard(nw, 2 * nz + parity), Position2D(from.x(), from.y()));
-        if (targetPiece != nullptr) {
-          break;
-        }
+bool IGame::isSquareAttacked(Vector4D square, PieceColor attacker) const {
+  Board* board = _boardAt(square.w(), 2 * square.z() + int(attacker));
+  if (board == nullptr) {
+    return false;
+  }
+  if (_isTipOf(square.w(), board->halfTurnNumber(), attacker)
+      and (board->attacks(attacker) >> Board::squareOf(Position2D(square.x(), square.y())) & 1)) {
+    return true;
+  }
+  _MoveConstraints constraints;
+  _constrainKing(square, attacker, _Overlay{}, -1, false, false, _LineFilter::ALL, constraints);
+  return constraints.impossible;
+}
+
+const IGame::_LegalityCache& IGame::_prepareLegality(void) const {
+  u64 key = hash();
+  if (_legality.valid and _legality.key == key) {
+    return _legality;
+  }
+  _legality.valid = true;
+  _legality.key = key;
+  // the contexts only ever grow, so that their king lists keep their memory when timelines are taken back
+  if (_legality.sources.size() < _timeLines.size()) {
+    _legality.sources.resize(_timeLines.size());
+  }
+  for (std::size_t timeLineID = 0; timeLineID < _timeLines.size(); timeLineID += 1) {
+    _legality.sources[timeLineID].ready = false;
+  }
+  _legality.targets.clear();
+  _legality.pairs.clear();
+
+  PieceColor attacker = opposite(_currentTurnColor);
+  const std::vector<Vector4D>& kings = _kings[int(_currentTurnColor)];
+  _legality.threatened.assign(kings.size(), false);
+  _legality.threats.clear();
+  _legality.exposed.clear();
+  _legality.inCheck = false;
+  for (const std::shared_ptr<TimeLine>& timeLine : _timeLines) {
+    int halfTurn = timeLine->halfTurnNumber();
+    if (halfTurn % 2 != int(attacker)) continue;
+    BoardAttackers attackers(*_boardAt(timeLine->ID(), halfTurn), attacker);
+    for (std::size_t index = 0; index < kings.size(); index += 1) {
+      if (not _legality.threatened[index] and mayAttack(attackers, timeLine->ID(), halfTurn, kings[index])) {
+        _legality.threatened[index] = true;
       }
     }
   }
+  for (std::size_t index = 0; index < kings.size(); index += 1) {
+    const Vector4D& king = kings[index];
+    if (_legality.threatened[index]) {
+      _legality.threats.push_back(int(index));
+    }
+    // moves only add boards, which never block a line between boards that already exist
+    bool onTip = _isTipOf(king.w(), 2 * king.z() + int(attacker), attacker);
+    if ((_legality.threatened[index] or onTip) and isSquareAttacked(king, attacker)) {
+      _legality.inCheck = true;
+    }
+  }
+  return _legality;
+}
+
+bool IGame::_mayBeAttacked(std::size_t index, const _Overlay& overlay) const {
+  if (_legality.threatened[index]) {
+    return true;
+  }
+  const Vector4D& king = _kings[int(_currentTurnColor)][index];
+  for (const _VirtualBoard& added : overlay) {
+    if (added.board != nullptr
+        and mayAttack(BoardAttackers(*added.board, opposite(_currentTurnColor)), added.timeLine, added.halfTurn, king)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+IGame::_KingRange IGame::_exposeKings(const _VirtualBoard& added) const {
+  const std::vector<Vector4D>& kings = _kings[int(_currentTurnColor)];
+  BoardAttackers attackers(*added.board, opposite(_currentTurnColor));
+  _KingRange range{int(_legality.exposed.size()), 0};
+  for (std::size_t index = 0; index < kings.size(); index += 1) {
+    if (not _legality.threatened[index] and mayAttack(attackers, added.timeLine, added.halfTurn, kings[index])) {
+      _legality.exposed.push_back(int(index));
+    }
+  }
+  range.end = int(_legality.exposed.size());
+  return range;
+}
+
+template<class Visit>
+void IGame::_visitKingsInReach(_KingRange first, _KingRange second, Visit visit) const {
+  for (int index : _legality.threats) {
+    if (not visit(index)) return;
+  }
+  // both ranges are sorted, a king exposed to both boards is visited once
+  const std::vector<int>& exposed = _legality.exposed;
+  while (first.begin < first.end or second.begin < second.end) {
+    int index;
+    if (second.begin == second.end or (first.begin < first.end and exposed[first.begin] < exposed[second.begin])) {
+      index = exposed[first.begin++];
+    } else {
+      index = exposed[second.begin++];
+      if (first.begin < first.end and exposed[first.begin] == index) first.begin += 1;
+    }
+    if (not visit(index)) return;
+  }
+}
 
-  if (piece->name() == "queen") {
-    for (int mask = 1; mask < (1 << 4); mask += 1) {
-      #define ONBIT(n) ((mask) & (1 << (n)))
-      int maxD = INT_MAX;
-      if (ONBIT(0) || ONBIT(1)) {
-        maxD = std::min(maxD, dim() - 1);
+const IGame::_SourceContext& IGame::_analyzeSource(int timeLineID) const {
+  _SourceContext& context = _legality.sources[timeLineID];
+  context.ready = true;
+  context.others = _MoveConstraints{};
+  context.away = _MoveConstraints{};
+  context.kings.clear();
+  context.pinned = 0;
+  context.pinLine.fill(~u64(0));
+
+  PieceColor attacker = opposite(_currentTurnColor);
+  const Board& board = tipBoard(timeLineID);
+  int fullTurn = (board.halfTurnNumber() + 1) / 2;
+  _Overlay overlay{_VirtualBoard{timeLineID, board.halfTurnNumber() + 1, &board}, _VirtualBoard{}};
+  const std::vector<Vector4D>& kings = _kings[int(_currentTurnColor)];
+  context.exposed = _exposeKings(overlay[0]);
+  _visitKingsInReach(context.exposed, _KingRange{}, [&](int index) {
+    if (mayLineUp(kings[index], overlay[0].timeLine, overlay[0].halfTurn)) {
+      _constrainKing(kings[index], attacker, overlay, 0, true, true, _LineFilter::PIVOT, context.others);
+    }
+    return not context.others.impossible;
+  });
+  context.onBoard = context.others;
+
+  for (const PlacedPiece& placed : board.pieces(_currentTurnColor)) {
+    if (pieceTypeOf(placed.code) != PieceType::PIECEKING) continue;
+    Position2D king = placed.position;
+    _KingSafety safety{Board::squareOf(king), ~u64(0), 0, false};
+    analyzeKingOnBoard(board, king, attacker, safety.checkMask, context.pinned, context.pinLine);
+    _MoveConstraints away;
+    _constrainKing(Vector4D(king.x(), king.y(), fullTurn, timeLineID), attacker, overlay, -1, false, false, _LineFilter::ALL, away);
+    safety.attackedAway = away.impossible;
+
+    // the king no longer shields the squares behind it once it steps away
+    Board lifted(_N, nullptr, board.halfTurnNumber());
+    lifted._state = board.state();
+    lifted.placePiece(king, EMPTY_SQUARE);
+    for (const Offset4D& step : Directions::KING) {
+      int x = king.x() + step.x, y = king.y() + step.y;
+      if (step.z != 0 or step.w != 0 or unsigned(x) >= unsigned(_N) or unsigned(y) >= unsigned(_N)) continue;
+      u64 bit = u64(1) << Board::squareOf(Position2D(x, y));
+      if (board.colorMask(_currentTurnColor) & bit) continue;
+      u64 checkMask = ~u64(0), pinned = 0;
+      std::array<u64, 64> pinLine;
+      analyzeKingOnBoard(lifted, Position2D(x, y), attacker, checkMask, pinned, pinLine);
+      _MoveConstraints constraints;
+      if (checkMask == ~u64(0)) {
+        _constrainKing(Vector4D(x, y, fullTurn, timeLineID), attacker, overlay, -1, false, false, _LineFilter::ALL, constraints);
       }
-      if (ONBIT(2)) {
-        maxD = std::min(maxD, selected.board->fullTurnNumber() + 1);
+      if (checkMask != ~u64(0) or constraints.impossible) {
+        safety.danger |= bit;
       }
-      if (ONBIT(3)) {
-        maxD = std::min(maxD, (int) _timeLines.size());
+    }
+
+    context.onBoard.requiredTo &= safety.checkMask;
+    context.onBoard.impossible |= safety.attackedAway;
+    context.kings.push_back(safety);
+  }
+
+  // a piece leaving the board fills nothing on it and opens the lines it blocked
+  context.away.exact = context.onBoard.exact;
+  context.away.impossible = context.onBoard.impossible or context.onBoard.requiredTo != ~u64(0);
+  context.away.forbiddenFrom = context.onBoard.forbiddenFrom | context.pinned;
+  return context;
+}
+
+const IGame::_TargetContext& IGame::_targetContext(int timeLineID, int halfTurn) const {
+  u64 key = _contextKey(0, timeLineID, halfTurn);
+  if (const _TargetContext* found = _legality.targets.find(key)) {
+    return *found;
+  }
+  _TargetContext context{};
+
+  PieceColor attacker = opposite(_currentTurnColor);
+  std::shared_ptr<Board> holder;
+  const Board* board = _holdBoardAt(timeLineID, halfTurn, holder);
+  int newTimeLineID = _timeLines[timeLineID]->halfTurnNumber() == halfTurn ? timeLineID : int(_timeLines.size());
+  _Overlay overlay{_VirtualBoard{newTimeLineID, halfTurn + 1, board}, _VirtualBoard{}};
+  // the piece arriving can block or capture a checker, nothing leaves the board
+  for (u64 kings = board->pieceMask(PieceType::PIECEKING, _currentTurnColor); kings; kings &= kings - 1) {
+    Position2D king = Board::positionOf(std::countr_zero(kings));
+    u64 pinned = 0;
+    std::array<u64, 64> pinLine;
+    analyzeKingOnBoard(*board, king, attacker, context.constraints.requiredTo, pinned, pinLine);
+    Vector4D square(king.x(), king.y(), (halfTurn + 1) / 2, newTimeLineID);
+    _constrainKing(square, attacker, overlay, -1, false, false, _LineFilter::ALL, context.constraints);
+  }
+  const std::vector<Vector4D>& kings = _kings[int(_currentTurnColor)];
+  context.exposed = _exposeKings(overlay[0]);
+  _visitKingsInReach(context.exposed, _KingRange{}, [&](int index) {
+    if (mayLineUp(kings[index], overlay[0].timeLine, overlay[0].halfTurn)) {
+      _constrainKing(kings[index], attacker, overlay, 0, true, false, _LineFilter::PIVOT, context.constraints);
+    }
+    return not context.constraints.impossible;
+  });
+  return _legality.targets.insert(key, context);
+}
+
+const IGame::_PairContext& IGame::_analyzePair(int fromTimeLineID, int toTimeLineID, int toHalfTurn) const {
+  u64 key = _contextKey(fromTimeLineID, toTimeLineID, toHalfTurn);
+  // the constraints of the target board are folded in, so that a move looks a single context up
+  const _TargetContext& arrival = _targetContext(toTimeLineID, toHalfTurn);
+  _KingRange targetExposed = arrival.exposed;
+  _PairContext context{arrival.constraints, arrival.constraints};
+  if (context.constraints.impossible or context.constraints.exact) {
+    return _legality.pairs.insert(key, context);
+  }
+
+  PieceColor attacker = opposite(_currentTurnColor);
+  const Board& source = tipBoard(fromTimeLineID);
+  std::shared_ptr<Board> holder;
+  const Board* target = _holdBoardAt(toTimeLineID, toHalfTurn, holder);
+  int newTimeLineID = _timeLines[toTimeLineID]->halfTurnNumber() == toHalfTurn ? toTimeLineID : int(_timeLines.size());
+  _Overlay overlay{_VirtualBoard{fromTimeLineID, source.halfTurnNumber() + 1, &source},
+                   _VirtualBoard{newTimeLineID, toHalfTurn + 1, target}};
+  // the lines between the two new boards, and the lines through both of them
+  for (u64 kings = target->pieceMask(PieceType::PIECEKING, _currentTurnColor); kings; kings &= kings - 1) {
+    Position2D king = Board::positionOf(std::countr_zero(kings));
+    Vector4D square(king.x(), king.y(), overlay[1].halfTurn / 2, newTimeLineID);
+    if (mayLineUp(square, overlay[0].timeLine, overlay[0].halfTurn)) {
+      _constrainKing(square, attacker, overlay, 0, false, true, _LineFilter::PIVOT, context.targetKings);
+    }
+  }
+  int apartZ = overlay[0].halfTurn / 2 - overlay[1].halfTurn / 2, apartW = overlay[0].timeLine - overlay[1].timeLine;
+  if (apartZ == 0 or apartW == 0 or std::abs(apartZ) == std::abs(apartW)) {
+    const std::vector<Vector4D>& kings = _kings[int(_currentTurnColor)];
+    _visitKingsInReach(_sourceContext(fromTimeLineID).exposed, targetExposed, [&](int index) {
+      const Vector4D& king = kings[index];
+      if (maySlideThrough(king, overlay[0].timeLine, overlay[0].halfTurn, overlay[1].timeLine, overlay[1].halfTurn)) {
+        _constrainKing(king, attacker, overlay, -1, false, false, _LineFilter::OVERLAY, context.targetKings);
       }
-      #undef ONBIT
-      for (int s0 : (mask & 1) ? std::initializer_list<int>{-1, +1} : std::initializer_list<int>{0})
-      for (int s1 : (mask & 2) ? std::initializer_list<int>{-1, +1} : std::initializer_list<int>{0})
-      for (int s2 : (mask & 4) ? std::initializer_list<int>{-1, +1} : std::initializer_list<int>{0})
-      for (int s3 : (mask & 8) ? std::initializer_list<int>{-1, +1} : std::initializer_list<int>{0}) {
-        for (int d = 1; d < maxD; d += 1) {
-          int nx = from.x() + s0 * d;
-          int ny = from.y() + s1 * d;
-          int nz = from.z() + s2 * d;
-          int nw = from.w() + s3 * d;
+      return not context.targetKings.exact;
+    });
+  }
+  context.constraints = context.targetKings;
+  for (u64 kings = source.pieceMask(PieceType::PIECEKING, _currentTurnColor); kings; kings &= kings - 1) {
+    Position2D king = Board::positionOf(std::countr_zero(kings));
+    Vector4D square(king.x(), king.y(), overlay[0].halfTurn / 2, fromTimeLineID);
+    if (mayLineUp(square, overlay[1].timeLine, overlay[1].halfTurn)) {
+      _constrainKing(square, attacker, overlay, 1, true, false, _LineFilter::PIVOT, context.constraints);
+    }
+  }
+  return _legality.pairs.insert(key, context);
+}
 
-          if (nx < 0 || nx >= dim() || ny < 0 || ny >= dim()) break;
-          if (!boardExists(nw, 2 * nz + parity)) break;
-          std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn({nx, ny, nz, nw});
-          if (targetPiece != nullptr && targetPiece->color() == _currentTurnColor) break;
+bool IGame::_isLegal(int fromTimeLine, int fromHalfTurn, Position2D from, PieceCode piece, int toTimeLine, int toHalfTurn, Position2D to) const {
+  if (_legality.inCheck) {
+    return false;
+  }
+  int fromSquare = Board::squareOf(from), toSquare = Board::squareOf(to);
+  const _SourceContext& source = _sourceContext(fromTimeLine);
+  auto exact = [&]() {
+    return not _leavesKingCapturable(fromTimeLine, fromHalfTurn, from, piece, toTimeLine, toHalfTurn, to);
+  };
+  auto allows = [fromSquare, toSquare](const _MoveConstraints& constraints) {
+    if (constraints.impossible or not (constraints.requiredTo >> toSquare & 1) or (constraints.forbiddenFrom >> fromSquare & 1)) {
+      return false;
+    }
+    for (int i = 0; i < constraints.clauseCount; i += 1) {
+      if ((constraints.clauses[i].from >> fromSquare & 1) and not (constraints.clauses[i].to >> toSquare & 1)) return false;
+    }
+    return true;
+  };
+  auto pinAllows = [&]() {
+    return not (source.pinned >> fromSquare & 1) or (source.pinLine[fromSquare] >> toSquare & 1);
+  };
 
-          std::shared_ptr<Board> targetBoard = getBoard(nw, 2 * nz + parity);
-          moveablePositions.emplace_back(targetBoard, Position2D(nx, ny));
-          if (targetPiece != nullptr) break;
+  if (pieceTypeOf(piece) == PieceType::PIECEKING) {
+    // a king carries the squares its safety depends on along, only the lines of the other kings are summarized
+    if (toTimeLine == fromTimeLine and toHalfTurn == fromHalfTurn) {
+      if (not allows(source.others) or not pinAllows()) return false;
+      for (const _KingSafety& king : source.kings) {
+        if (king.square == fromSquare ? (king.danger >> toSquare & 1) : (king.attackedAway or not (king.checkMask >> toSquare & 1))) {
+          return false;
         }
       }
+      return true;
+    }
+    // the kings staying behind keep their checks, and a king shielding them cannot leave
+    if (source.others.impossible or source.others.requiredTo != ~u64(0) or (source.others.forbiddenFrom >> fromSquare & 1)
+        or (source.pinned >> fromSquare & 1)) {
+      return false;
     }
+    for (const _KingSafety& king : source.kings) {
+      if (king.square != fromSquare and (king.attackedAway or king.checkMask != ~u64(0))) return false;
+    }
+    const _MoveConstraints& pair = _pairContext(fromTimeLine, toTimeLine, toHalfTurn).targetKings;
+    if (pair.exact) return exact();
+    if (not allows(pair)) return false;
+
+    PieceColor attacker = opposite(_currentTurnColor);
+    std::shared_ptr<Board> holder;
+    const Board* board = _holdBoardAt(toTimeLine, toHalfTurn, holder);
+    if (board->attacks(attacker) >> toSquare & 1) {
+      return false;
+    }
+    int newTimeLineID = _timeLines[toTimeLine]->halfTurnNumber() == toHalfTurn ? toTimeLine : int(_timeLines.size());
+    _Overlay overlay{_VirtualBoard{fromTimeLine, fromHalfTurn + 1, &tipBoard(fromTimeLine)},
+                     _VirtualBoard{newTimeLineID, toHalfTurn + 1, board}};
+    _MoveConstraints constraints;
+    _constrainKing(Vector4D(to.x(), to.y(), (toHalfTurn + 1) / 2, newTimeLineID), attacker, overlay, 0, false, true, _LineFilter::ALL, constraints);
+    for (const _KingSafety& king : source.kings) {
+      if (king.square == fromSquare) continue;
+      Position2D position = Board::positionOf(king.square);
+      _constrainKing(Vector4D(position.x(), position.y(), (fromHalfTurn + 1) / 2, fromTimeLine), attacker, overlay, 1, true, false, _LineFilter::PIVOT, constraints);
+    }
+    return allows(constraints);
   }
 
-  if (piece->name() == "king") {
-    for (int dx = -1; dx <= +1; dx += 1)
-    for (int dy = -1; dy <= +1; dy += 1)
-    for (int dz = -1; dz <= 0; dz += 1)
-    for (int dw = -1; dw <= +1; dw += 1) {
-      if (dx == 0 && dy == 0 && dz == 0 && dw == 0) continue;
-      Vector4D to = Vector4D(from.x() + dx, from.y() + dy, from.z() + dz, from.w() + dw);
-      if (to.x() >= 0 && to.x() < dim() && to.y() >= 0 && to.y() < dim()) {
-        if (boardExists(to.w(), 2 * to.z() + parity)) {
-          std::shared_ptr<Piece> targetPiece = _getPieceByVector4DFullTurn(to);
-          if (targetPiece and targetPiece->color() == _currentTurnColor)
-            continue;
-          moveablePositions.emplace_back(getBoard(to.w(), 2 * to.z() + parity), Position2D(to.x(), to.y()));
-        }
+  if (toTimeLine == fromTimeLine and toHalfTurn == fromHalfTurn) {
+    if (source.onBoard.exact) return exact();
+    return allows(source.onBoard) and pinAllows();
+  }
+
+  if (source.away.exact) return exact();
+  if (not allows(source.away)) return false;
+  const _MoveConstraints& pair = _pairContext(fromTimeLine, toTimeLine, toHalfTurn).constraints;
+  if (pair.exact) return exact();
+  return allows(pair);
+}
+
+bool IGame::_leavesKingCapturable(int fromTimeLine, int fromHalfTurn, Position2D from, PieceCode piece, int toTimeLine, int toHalfTurn, Position2D to) const {
+  PieceColor attacker = opposite(_currentTurnColor);
+  PieceCode landing = landingPiece(piece, to, _N);
+  bool onBoard = toTimeLine == fromTimeLine and toHalfTurn == fromHalfTurn;
+
+  Board source(_N, nullptr, fromHalfTurn + 1);
+  source._state = _boardAt(fromTimeLine, fromHalfTurn)->state();
+  source.placePiece(from, EMPTY_SQUARE);
+  if (onBoard) {
+    source.placePiece(to, landing);
+  }
+  _Overlay overlay{_VirtualBoard{fromTimeLine, fromHalfTurn + 1, &source}, _VirtualBoard{}};
+
+  Board target(_N, nullptr, toHalfTurn + 1);
+  if (not onBoard) {
+    target._state = _boardAt(toTimeLine, toHalfTurn)->state();
+    target.placePiece(to, landing);
+    int newTimeLineID = _timeLines[toTimeLine]->halfTurnNumber() == toHalfTurn ? toTimeLine : int(_timeLines.size());
+    overlay[1] = _VirtualBoard{newTimeLineID, toHalfTurn + 1, &target};
+  }
+
+  for (const _VirtualBoard& added : overlay) {
+    if (added.board == nullptr) continue;
+    for (u64 kings = added.board->pieceMask(PieceType::PIECEKING, _currentTurnColor); kings; kings &= kings - 1) {
+      Position2D king = Board::positionOf(std::countr_zero(kings));
+      u64 checkMask = ~u64(0), pinned = 0;
+      std::array<u64, 64> pinLine;
+      analyzeKingOnBoard(*added.board, king, attacker, checkMask, pinned, pinLine);
+      if (checkMask != ~u64(0)) return true;
+      _MoveConstraints constraints;
+      _constrainKing(Vector4D(king.x(), king.y(), added.halfTurn / 2, added.timeLine), attacker, overlay, -1, false, false, _LineFilter::ALL, constraints);
+      if (constraints.impossible) return true;
+    }
+  }
+  // the other lines were already checked by _prepareLegality, and the boards of the move are final here, so nothing can be filled or vacated
+  const std::vector<Vector4D>& kings = _kings[int(_currentTurnColor)];
+  for (std::size_t index = 0; index < kings.size(); index += 1) {
+    const Vector4D& king = kings[index];
+    if (not _mayBeAttacked(index, overlay)) continue;
+    _MoveConstraints constraints;
+    for (int pivot = 0; pivot < 2 and not constraints.impossible; pivot += 1) {
+      if (overlay[pivot].board != nullptr and mayLineUp(king, overlay[pivot].timeLine, overlay[pivot].halfTurn)) {
+        _constrainKing(king, attacker, overlay, pivot, false, false, _LineFilter::PIVOT, constraints);
       }
     }
+    if (constraints.impossible) return true;
   }
+  return _legality.inCheck;
+}
+
+bool IGame::isInCheck(PieceColor color) const {
+  PieceColor attacker = opposite(color);
+  // only the kings on the boards of the attacker's half turns can be captured, _kings holds exactly those
+  for (const Vector4D& king : _kings[int(color)]) {
+    if (isSquareAttacked(king, attacker)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<int N>
+void IGame::_generateMoves(const Board& board, Vector4D from, PieceCode piece, _MoveTargetWriter& writer) const {
+  int parity = int(_currentTurnColor);
+  Position2D position(from.x(), from.y());
+  u64 occupied = board.occupancy();
+
+  // pushes every square of a mask on the piece's own board
+  auto pushBoardTargets = [&](u64 targets) {
+    for (targets &= ~board.colorMask(_currentTurnColor); targets; targets &= targets - 1) {
+      Position2D to = Board::positionOf(std::countr_zero(targets));
+      writer.push(from.w(), board.halfTurnNumber(), to.x(), to.y());
+    }
+  };
 
-  if (piece->name() == "pawn") {
-    if (piece->color() == PieceColor::PIECEWHITE) {
-      if (piece->getPosition().y() < dim() - 1 and piece->getPosition().x() > 0) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x() - 1, from.y() + 1));
-        if (targetPiece != nullptr and targetPiece->color() == PieceColor::PIECEBLACK) {
-          moveablePositions.emplace_back(selected.board, Position2D(from.x() - 1, from.y() + 1));
+  // walks one direction of the multiverse from the piece, stepping once for leapers
+  // a slide across turns covers at most as many turns as the selected board has behind it
+  auto scan = [&](const Offset4D& step, bool slide) {
+    int nx = from.x(), ny = from.y(), nz = from.z(), nw = from.w();
+    for (int remaining = not slide ? 1 : step.z != 0 ? from.z() : INT_MAX; remaining > 0; remaining -= 1) {
+      nx += step.x;
+      ny += step.y;
+      nz += step.z;
+      nw += step.w;
+      if (unsigned(nx) >= unsigned(N) or unsigned(ny) >= unsigned(N)) return;
+      Board* target = _boardAt(nw, 2 * nz + parity);
+      if (target == nullptr) return;
+      std::optional<PieceColor> targetColor = target->colorAt(Position2D(nx, ny));
+      if (targetColor == _currentTurnColor) return;
+      writer.push(nw, 2 * nz + parity, nx, ny);
+      if (targetColor) return;
+    }
+  };
+
+  switch (pieceTypeOf(piece)) {
+  case PieceType::PIECEROOK: {
+    u64 targets = slidingRay<N, 1, 0>(occupied, position)
+                | slidingRay<N, -1, 0>(occupied, position)
+                | slidingRay<N, 0, 1>(occupied, position)
+                | slidingRay<N, 0, -1>(occupied, position);
+    pushBoardTargets(targets);
+    for (const Offset4D& direction : Directions::ROOK) {
+      if (direction.z != 0 or direction.w != 0) scan(direction, true);
+    }
+    break;
+  }
+
+  case PieceType::PIECEKNIGHT: {
+    for (const Offset4D& leap : Directions::KNIGHT) {
+      scan(leap, false);
+    }
+    break;
+  }
+
+  case PieceType::PIECEBISHOP: {
+    u64 targets = slidingRay<N, 1, 1>(occupied, position)
+                | slidingRay<N, 1, -1>(occupied, position)
+                | slidingRay<N, -1, 1>(occupied, position)
+                | slidingRay<N, -1, -1>(occupied, position);
+    pushBoardTargets(targets);
+    for (const Offset4D& direction : Directions::BISHOP) {
+      if (direction.z != 0 or direction.w != 0) scan(direction, true);
+    }
+    break;
+  }
+
+  case PieceType::PIECEQUEEN: {
+    u64 targets = slidingRay<N, 1, 0>(occupied, position)
+                | slidingRay<N, -1, 0>(occupied, position)
+                | slidingRay<N, 0, 1>(occupied, position)
+                | slidingRay<N, 0, -1>(occupied, position)
+                | slidingRay<N, 1, 1>(occupied, position)
+                | slidingRay<N, 1, -1>(occupied, position)
+                | slidingRay<N, -1, 1>(occupied, position)
+                | slidingRay<N, -1, -1>(occupied, position);
+    pushBoardTargets(targets);
+    for (const Offset4D& direction : Directions::QUEEN) {
+      if (direction.z != 0 or direction.w != 0) scan(direction, true);
+    }
+    break;
+  }
+
+  case PieceType::PIECEKING: {
+    for (const Offset4D& step : Directions::KING) {
+      scan(step, false);
+    }
+    break;
+  }
+
+  case PieceType::PIECEPAWN: {
+    if (pieceColorOf(piece) == PieceColor::PIECEWHITE) {
+      if (position.y() < N - 1 and position.x() > 0) {
+        if (board.colorAt(Position2D(from.x() - 1, from.y() + 1)) == PieceColor::PIECEBLACK) {
+          writer.push(from.w(), board.halfTurnNumber(), from.x() - 1, from.y() + 1);
         }
       }
-      if (piece->getPosition().y() < dim() - 1 and piece->getPosition().x() < dim() - 1) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x() + 1, from.y() + 1));
-        if (targetPiece != nullptr and targetPiece->color() == PieceColor::PIECEBLACK) {
-          moveablePositions.emplace_back(selected.board, Position2D(from.x() + 1, from.y() + 1));
+      if (position.y() < N - 1 and position.x() < N - 1) {
+        if (board.colorAt(Position2D(from.x() + 1, from.y() + 1)) == PieceColor::PIECEBLACK) {
+          writer.push(from.w(), board.halfTurnNumber(), from.x() + 1, from.y() + 1);
         }
       }
-      if (piece->getPosition().y() < dim() - 1) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x(), from.y() + 1));
-        if (targetPiece != nullptr)
+      if (position.y() < N - 1) {
+        if (board.isOccupied(Position2D(from.x(), from.y() + 1)))
           goto SKIP_PAWN_MOVE;
-        moveablePositions.emplace_back(selected.board, Position2D(from.x(), from.y() + 1));
+        writer.push(from.w(), board.halfTurnNumber(), from.x(), from.y() + 1);
       }
 
-      if (_rule.pawnCanMakeTwoMoveOnFirstTurn and piece->getPosition().y() == 1) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x(), from.y() + 2));
-        if (targetPiece != nullptr)
+      if (_rule.pawnCanMakeTwoMoveOnFirstTurn and position.y() == 1) {
+        if (board.isOccupied(Position2D(from.x(), from.y() + 2)))
           goto SKIP_PAWN_MOVE;
-        moveablePositions.emplace_back(selected.board, Position2D(from.x(), from.y() + 2));
+        writer.push(from.w(), board.halfTurnNumber(), from.x(), from.y() + 2);
       }
     }
-    if (piece->color() == PieceColor::PIECEBLACK) {
-      if (piece->getPosition().y() > 0 and piece->getPosition().x() > 0) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x() - 1, from.y() - 1));
-        if (targetPiece != nullptr and targetPiece->color() == PieceColor::PIECEWHITE) {
-          moveablePositions.emplace_back(selected.board, Position2D(from.x() - 1, from.y() - 1));
+    if (pieceColorOf(piece) == PieceColor::PIECEBLACK) {
+      if (position.y() > 0 and position.x() > 0) {
+        if (board.colorAt(Position2D(from.x() - 1, from.y() - 1)) == PieceColor::PIECEWHITE) {
+          writer.push(from.w(), board.halfTurnNumber(), from.x() - 1, from.y() - 1);
         }
       }
-      if (piece->getPosition().y() > 0 and piece->getPosition().x() < dim() - 1) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x() + 1, from.y() - 1));
-        if (targetPiece != nullptr and targetPiece->color() == PieceColor::PIECEWHITE) {
-          moveablePositions.emplace_back(selected.board, Position2D(from.x() + 1, from.y() - 1));
+      if (position.y() > 0 and position.x() < N - 1) {
+        if (board.colorAt(Position2D(from.x() + 1, from.y() - 1)) == PieceColor::PIECEWHITE) {
+          writer.push(from.w(), board.halfTurnNumber(), from.x() + 1, from.y() - 1);
         }
       }
-      if (piece->getPosition().y() > 0) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x(), from.y() - 1));
-        if (targetPiece != nullptr)
+      if (position.y() > 0) {
+        if (board.isOccupied(Position2D(from.x(), from.y() - 1)))
           goto SKIP_PAWN_MOVE;
-        moveablePositions.emplace_back(selected.board, Position2D(from.x(), from.y() - 1));
+        writer.push(from.w(), board.halfTurnNumber(), from.x(), from.y() - 1);
       }
-      if (_rule.pawnCanMakeTwoMoveOnFirstTurn and piece->getPosition().y() == dim() - 2) {
-        std::shared_ptr<Piece> targetPiece = selected.board->getPiece(Position2D(from.x(), from.y() - 2));
-        if (targetPiece != nullptr)
+      if (_rule.pawnCanMakeTwoMoveOnFirstTurn and position.y() == N - 2) {
+        if (board.isOccupied(Position2D(from.x(), from.y() - 2)))
           goto SKIP_PAWN_MOVE;
-        moveablePositions.emplace_back(selected.board, Position2D(from.x(), from.y() - 2));
+        writer.push(from.w(), board.halfTurnNumber(), from.x(), from.y() - 2);
       }
     }
     SKIP_PAWN_MOVE:;
+    break;
   }
+  }
+}
 
-  return moveablePositions;
+u8 IGame::_moveFlags(PieceCode piece, int fromTimeLine, int fromHalfTurn, int toTimeLine, int toHalfTurn, Position2D to) const {
+  u8 flags = 0;
+  if (_boardAt(toTimeLine, toHalfTurn)->isOccupied(to)) {
+    flags |= PackedMove::CAPTURE;
+  }
+  if ((piece == WHITE_PAWN and to.y() == dim() - 1) or (piece == BLACK_PAWN and to.y() == 0)) {
+    flags |= PackedMove::PROMOTION;
+  }
+  if (toTimeLine != fromTimeLine or toHalfTurn != fromHalfTurn) {
+    flags |= PackedMove::TIME_TRAVEL;
+    if (toHalfTurn != _timeLines[toTimeLine]->halfTurnNumber()) {
+      flags |= PackedMove::BRANCHING;
+    }
+  }
+  return flags;
 }
 
-void IGame::makeMove(Move move) {
-  std::vector<int> list;
-  std::shared_ptr<Piece> piece = move.from.board->getPiece(move.from.position);
-  assert(piece != nullptr);
-  assert(piece->color() == _currentTurnColor);
-  std::shared_ptr<Piece> moveToPiece = move.to.board->getPiece(move.to.position);
-  if (moveToPiece != nullptr and moveToPiece->name() == "king") {
-    assert(moveToPiece->color() != _currentTurnColor);
+PackedMove IGame::pack(const Move& move) const {
+  int fromTimeLine = move.from.board->timeLineID();
+  int toTimeLine = move.to.board->timeLineID();
+  PieceCode piece = move.from.board->pieceAt(move.from.position);
+  u8 flags = _moveFlags(piece, fromTimeLine, move.from.board->halfTurnNumber(), toTimeLine, move.to.board->halfTurnNumber(), move.to.position);
+  return PackedMove(fromTimeLine, move.from.board->halfTurnNumber(), move.from.position,
+                    toTimeLine, move.to.board->halfTurnNumber(), move.to.position, flags);
+}
+
+PackedMove IGame::pack(const SelectedPosition& from, const MoveTarget& target) const {
+  return pack(Move{from, toSelectedPosition(target)});
+}
+
+void IGame::doMove(PackedMove move) {
+  int fromTimeLine = move.fromTimeLine();
+  int toTimeLine = move.toTimeLine();
+  const Board* from = _boardAt(fromTimeLine, move.fromHalfTurn());
+  assert(from != nullptr and move.fromHalfTurn() == _timeLines[fromTimeLine]->halfTurnNumber());
+  PieceCode piece = from->pieceAt(move.from());
+  assert(piece != EMPTY_SQUARE);
+  assert(pieceColorOf(piece) == _currentTurnColor);
+  if (_exceedsPackedLimits(move.fromHalfTurn(), toTimeLine, move.toHalfTurn())) {
+    throw std::length_error("The move makes a board past the timelines or half turns a PackedMove can hold");
+  }
+  UndoRecord record{move, -1, false};
+  PieceCode captured = _boardAt(toTimeLine, move.toHalfTurn())->pieceAt(move.to());
+  if (captured != EMPTY_SQUARE and pieceTypeOf(captured) == PieceType::PIECEKING) {
+    assert(pieceColorOf(captured) != _currentTurnColor);
+    record.endedGame = not _gameWinner.has_value();
     _gameWinner = _currentTurnColor;
   }
   _currentTurnMoves.push_back(move);
-  std::shared_ptr<Board> newFromBoard = move.from.board->createFork(move.from.board->getTimeLine());
-  move.from.board->getTimeLine()->pushBack(newFromBoard);
-  newFromBoard->placePiece(move.from.position, nullptr);
-  if (move.to.position.y() == 0 and piece->name() == "pawn" and piece->color() == PieceColor::PIECEBLACK) {
-    piece = std::make_shared<Queen>(PieceColor::PIECEBLACK);
-  }
-  if (move.to.position.y() == dim() - 1 and piece->name() == "pawn" and piece->color() == PieceColor::PIECEWHITE) {
-    piece = std::make_shared<Queen>(PieceColor::PIECEWHITE);
-  }
-  list.push_back(newFromBoard->getTimeLine()->ID());
-  if (move.to.board == move.from.board) {
-    newFromBoard->placePiece(move.to.position, piece->clone());
-    _nextHalfTurnBuffer.push_back(newFromBoard->halfTurnNumber());
-    _undoBuffer.push_back(list);
+  bool sameBoard = toTimeLine == fromTimeLine and move.toHalfTurn() == move.fromHalfTurn();
+  std::shared_ptr<Board> newFromBoard = _forkBoard(*from, _timeLines[fromTimeLine]);
+  newFromBoard->placePiece(move.from(), EMPTY_SQUARE);
+  piece = landingPiece(piece, move.to(), dim());
+  if (sameBoard) {
+    newFromBoard->placePiece(move.to(), piece);
+  }
+  int newFromHalfTurn = newFromBoard->halfTurnNumber();
+  // boards are only hashed into the multiverse once, so every placement happens before the push
+  _pushBoard(fromTimeLine, std::move(newFromBoard));
+  if (sameBoard) {
+    _pushNextHalfTurn(newFromHalfTurn);
+    _undoBuffer.push_back(record);
     return;
   }
 
-  std::shared_ptr<TimeLine> toTimeLine = move.to.board->halfTurnNumber() == move.to.board->getTimeLine()->halfTurnNumber()
-    ? move.to.board->getTimeLine()
-    : move.to.board->getTimeLine()->createFork(_timeLines.size(), move.to.board->halfTurnNumber());
-
-  if (toTimeLine != move.to.board->getTimeLine()) {
-    _timeLines.push_back(toTimeLine);
+  // looked up after the push, a board rebuilt from deltas stays valid until the next rebuild
+  const Board* target = _boardAt(toTimeLine, move.toHalfTurn());
+  record.toTimeLine = toTimeLine;
+  if (move.toHalfTurn() != _timeLines[toTimeLine]->halfTurnNumber()) {
+    record.toTimeLine = _timeLines.size();
+    _pushBack(_forkTimeLine(toTimeLine, move.toHalfTurn()));
+    _timeLineBalance += _currentTurnColor == PieceColor::PIECEWHITE ? 1 : -1;
   }
+  std::shared_ptr<Board> newToBoard = _forkBoard(*target, _timeLines[record.toTimeLine]);
+  newToBoard->placePiece(move.to(), piece);
+  int newToHalfTurn = newToBoard->halfTurnNumber();
+  _pushBoard(record.toTimeLine, std::move(newToBoard));
 
-  list.push_back(toTimeLine->ID());
-
-  std::shared_ptr<Board> newToBoard = move.to.board->getTimeLine()->getBoardByHalfTurn(move.to.board->halfTurnNumber())->createFork(toTimeLine);
-  newToBoard->placePiece(move.to.position, piece->clone());
-  toTimeLine->pushBack(newToBoard);
+  _pushNextHalfTurn(newToHalfTurn);
+  _undoBuffer.push_back(record);
+}
 
-  _nextHalfTurnBuffer.push_back(newToBoard->halfTurnNumber());
-  _undoBuffer.push_back(list);
+void IGame::_passTurn(void) {
+  _currentTurnColor = opposite(_currentTurnColor);
+  _presentHalfTurn = bufferHalfTurn();
+  // the tips only move during a turn, the present moves once per turn
+  for (int timeLineID = 0; timeLineID < int(_timeLines.size()); timeLineID += 1) {
+    _updateMoveable(timeLineID);
+  }
 }
 
 void IGame::submitTurn(void) {
+  _passTurn();
   _currentTurnMoves.clear();
-  _currentTurnColor = opposite(_currentTurnColor);
-  _presentHalfTurn = *std::min_element(_nextHalfTurnBuffer.begin(), _nextHalfTurnBuffer.end());
   _nextHalfTurnBuffer.clear();
   _undoBuffer.clear();
+  _turnBuffer.clear();
+  _turnStart = 0;
+}
+
+void IGame::doSubmit(void) {
+  _turnBuffer.push_back(TurnRecord{_turnStart, _presentHalfTurn});
+  _passTurn();
+  _turnStart = _currentTurnMoves.size();
+}
+
+void IGame::undoSubmit(void) {
+  assert(submitUndoable());
+  TurnRecord record = _turnBuffer.back();
+  _turnBuffer.pop_back();
+  _turnStart = record.turnStart;
+  _currentTurnColor = opposite(_currentTurnColor);
+  _presentHalfTurn = record.presentHalfTurn;
+  for (int timeLineID = 0; timeLineID < int(_timeLines.size()); timeLineID += 1) {
+    _updateMoveable(timeLineID);
+  }
+}
+
+int choosePivot(const IGame& game, std::span<const PackedMove> moves, std::span<const int> boards, std::vector<int>& options) {
+  if (boards.size() == 1) {
+    return moves.empty() ? -1 : boards[0];
+  }
+  // a board is settled by one of its moves or by a move arriving on it, count both
+  options.assign(game.timeLineCount(), 0);
+  for (PackedMove move : moves) {
+    options[move.fromTimeLine()] += 1;
+    if (move.toTimeLine() != move.fromTimeLine() and settles(game, move, move.toTimeLine())) {
+      options[move.toTimeLine()] += 1;
+    }
+  }
+  int pivot = -1;
+  int fewest = INT_MAX;
+  for (int timeLineID : boards) {
+    if (options[timeLineID] == 0) {
+      return -1;
+    }
+    if (options[timeLineID] < fewest) {
+      pivot = timeLineID;
+      fewest = options[timeLineID];
+    }
+  }
+  return pivot;
+}
+
+TurnSolver::TurnSolver(IGame& game, std::size_t cacheSize) : _game(game), _cacheSize(cacheSize) {}
+
+// the key of a set of boards is the XOR of the keys of its timelines
+static inline u64 timeLineSetKey(int timeLineID) {
+  return Zobrist::mix(0x7e7e5e7ULL ^ u64(u32(timeLineID)) << 20);
+}
+
+std::vector<int> TurnSolver::_prepare(void) {
+  std::vector<int> moveable;
+  int timeLineCount = _game.timeLineCount();
+  _landings.assign(timeLineCount, {});
+  for (int timeLineID = 0; timeLineID < timeLineCount; timeLineID += 1) {
+    if (not _game.isMoveable(timeLineID)) continue;
+    moveable.push_back(timeLineID);
+    std::vector<int>& landings = _landings[timeLineID];
+    _buffer.clear();
+    _game.generateMoves(timeLineID, _buffer, MoveFilter::PSEUDO_LEGAL);
+    for (PackedMove move : _buffer) {
+      if (not move.hasFlag(PackedMove::BRANCHING) and move.toTimeLine() != timeLineID
+          and std::find(landings.begin(), landings.end(), move.toTimeLine()) == landings.end()) {
+        landings.push_back(move.toTimeLine());
+      }
+    }
+  }
+  return moveable;
+}
+
+std::vector<std::vector<int>> TurnSolver::_groups(const std::vector<int>& moveable) const {
+  // union-find over timeline IDs, a board is linked to every timeline it lands on the tip of
+  std::vector<int> parent(_landings.size());
+  for (int i = 0; i < int(parent.size()); i += 1) {
+    parent[i] = i;
+  }
+  auto find = [&parent](int i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  };
+  for (int timeLineID : moveable) {
+    for (int target : _landings[timeLineID]) {
+      parent[find(target)] = find(timeLineID);
+    }
+  }
+
+  std::vector<std::vector<int>> groups;
+  std::vector<int> groupOf(_landings.size(), -1);
+  for (int timeLineID : moveable) {
+    int root = find(timeLineID);
+    if (groupOf[root] < 0) {
+      groupOf[root] = groups.size();
+      groups.emplace_back();
+    }
+    groups[groupOf[root]].push_back(timeLineID);
+  }
+  return groups;
+}
+
+bool TurnSolver::_search(int depth, u64 key) {
+  _nodes += 1;
+  const std::vector<int>& remaining = _remaining[depth];
+  if (remaining.empty()) {
+    // the moves made before the search are the only ones not checked on the way
+    if (depth == 0 and _game.isInCheck(_game.getCurrentTurnColor())) {
+      return false;
+    }
+    if (_visit == nullptr) {
+      _solution = _path;
+      return true;
+    }
+    _visited += 1;
+    if (not (*_visit)(_path)) {
+      _limit = _visited;
+    }
+    return true;
+  }
+
+  u64 cacheKey = _game.hash() ^ key;
+  if (_refuted.contains(cacheKey)) {
+    return false;
+  }
+
+  std::size_t begin = _moves.size();
+  for (int timeLineID : remaining) {
+    _buffer.clear();
+    _game.generateMoves(timeLineID, _buffer, MoveFilter::LEGAL);
+    _moves.insert(_moves.end(), _buffer.begin(), _buffer.end());
+  }
+  std::size_t end = _moves.size();
+  int pivot = choosePivot(_game, std::span<const PackedMove>(_moves).subspan(begin), remaining, _options);
+
+  bool found = false;
+  if (pivot >= 0) {
+    if (int(_remaining.size()) <= depth + 1) {
+      _remaining.resize(depth + 2);
+    }
+    // quiet moves first, then moves to other boards, then moves creating a timeline
+    for (int pass = 0; pass < 3 and _visited < _limit and not (found and _visit == nullptr); pass += 1) {
+      for (std::size_t i = begin; i < end and _visited < _limit; i += 1) {
+        PackedMove move = _moves[i];
+        int kind = move.hasFlag(PackedMove::BRANCHING) ? 2 : move.hasFlag(PackedMove::TIME_TRAVEL) ? 1 : 0;
+        if (kind != pass or not settles(_game, move, pivot)) continue;
+
+        std::vector<int>& next = _remaining[depth + 1];
+        next.clear();
+        for (int timeLineID : _remaining[depth]) {
+          if (not settles(_game, move, timeLineID)) {
+            next.push_back(timeLineID);
+          }
+        }
+        _game.doMove(move);
+        _path.push_back(move);
+        found = _search(depth + 1, key) or found;
+        _path.pop_back();
+        _game.undoMove();
+        if (found and _visit == nullptr) break;
+      }
+    }
+  }
+  _moves.resize(begin);
+
+  if (not found and _visited < _limit) {
+    if (_refuted.size() >= _cacheSize) {
+      _refuted.clear();
+    }
+    _refuted.insert(cacheKey);
+  }
+  return found;
+}
+
+bool TurnSolver::_solveGroup(const std::vector<int>& group, std::vector<PackedMove>& turn) {
+  u64 key = 0;
+  for (int timeLineID : group) {
+    key ^= timeLineSetKey(timeLineID);
+  }
+  _path.clear();
+
+  // most positions have plenty of turns, a dive through the boards with the fewest moves first finds one
+  // at the cost of generating the moves of each board once
+  std::vector<std::pair<int, int>> moveCounts;
+  for (int timeLineID : group) {
+    _buffer.clear();
+    moveCounts.emplace_back(_game.generateMoves(timeLineID, _buffer, MoveFilter::LEGAL), timeLineID);
+  }
+  std::sort(moveCounts.begin(), moveCounts.end());
+  _remaining.resize(1);
+  _remaining[0].clear();
+  for (const std::pair<int, int>& count : moveCounts) {
+    _remaining[0].push_back(count.second);
+  }
+  _budget = _nodes + DIVE_BUDGET * group.size();
+  if (moveCounts.front().first > 0 and _dive(0)) {
+    turn = _solution;
+    return true;
+  }
+
+  _remaining[0] = group;
+  if (not _search(0, key)) {
+    return false;
+  }
+  turn = _solution;
+  return true;
+}
+
+bool TurnSolver::_dive(int depth) {
+  _nodes += 1;
+  if (_remaining[depth].empty()) {
+    _solution = _path;
+    return true;
+  }
+  if (_nodes > _budget) {
+    return false;
+  }
+
+  int pivot = _remaining[depth].front();
+  std::size_t begin = _moves.size();
+  _buffer.clear();
+  _game.generateMoves(pivot, _buffer, MoveFilter::LEGAL);
+  _moves.insert(_moves.end(), _buffer.begin(), _buffer.end());
+  std::size_t end = _moves.size();
+  if (int(_remaining.size()) <= depth + 1) {
+    _remaining.resize(depth + 2);
+  }
+
+  bool found = false;
+  for (int pass = 0; pass < 3 and not found; pass += 1) {
+    for (std::size_t i = begin; i < end and not found; i += 1) {
+      PackedMove move = _moves[i];
+      int kind = move.hasFlag(PackedMove::BRANCHING) ? 2 : move.hasFlag(PackedMove::TIME_TRAVEL) ? 1 : 0;
+      if (kind != pass) continue;
+      std::vector<int>& next = _remaining[depth + 1];
+      next.clear();
+      for (int timeLineID : _remaining[depth]) {
+        if (not settles(_game, move, timeLineID)) {
+          next.push_back(timeLineID);
+        }
+      }
+      _game.doMove(move);
+      _path.push_back(move);
+      found = _dive(depth + 1);
+      _path.pop_back();
+      _game.undoMove();
+    }
+  }
+  _moves.resize(begin);
+  return found;
+}
+
+int TurnSolver::_conflict(const std::vector<const std::vector<PackedMove>*>& turns) {
+  int made = 0;
+  int conflict = -1;
+  for (int i = 0; i < int(turns.size()) and conflict < 0; i += 1) {
+    for (PackedMove move : *turns[i]) {
+      if (not _game.isLegal(move)) {
+        conflict = i;
+        break;
+      }
+      _game.doMove(move);
+      made += 1;
+    }
+  }
+  for (; made > 0; made -= 1) {
+    _game.undoMove();
+  }
+  return conflict;
+}
+
+bool TurnSolver::hasLegalTurn(std::vector<PackedMove>* turn) {
+  _visit = nullptr;
+  _limit = UINT64_MAX;
+  _visited = 0;
+  std::vector<std::vector<int>> groups = _groups(_prepare());
+  if (groups.empty()) {
+    if (turn != nullptr) {
+      turn->clear();
+    }
+    return not _game.isInCheck(_game.getCurrentTurnColor());
+  }
+  std::vector<std::vector<PackedMove>> turns(groups.size());
+  std::vector<bool> solved(groups.size(), false);
+
+  while (true) {
+    // a group without a legal turn of its own sinks the whole turn, the other groups only add checks
+    for (int i = 0; i < int(groups.size()); i += 1) {
+      if (not solved[i] and not _solveGroup(groups[i], turns[i])) {
+        return false;
+      }
+      solved[i] = true;
+    }
+
+    std::vector<const std::vector<PackedMove>*> order;
+    for (const std::vector<PackedMove>& groupTurn : turns) {
+      order.push_back(&groupTurn);
+    }
+    int conflict = _conflict(order);
+    if (conflict < 0) {
+      if (turn != nullptr) {
+        turn->clear();
+        for (const std::vector<PackedMove>& groupTurn : turns) {
+          turn->insert(turn->end(), groupTurn.begin(), groupTurn.end());
+        }
+      }
+      return true;
+    }
+
+    // the groups interfere through their checks, merge the conflicting one with those it clashes with
+    std::vector<int> partners;
+    for (int i = 0; i < conflict; i += 1) {
+      if (_conflict({&turns[i], &turns[conflict]}) >= 0) {
+        partners.push_back(i);
+      }
+    }
+    if (partners.empty()) {
+      for (int i = 0; i < conflict; i += 1) {
+        partners.push_back(i);
+      }
+    }
+    partners.push_back(conflict);
+    std::vector<int> merged;
+    for (int i = int(partners.size()) - 1; i >= 0; i -= 1) {
+      merged.insert(merged.end(), groups[partners[i]].begin(), groups[partners[i]].end());
+      groups.erase(groups.begin() + partners[i]);
+      turns.erase(turns.begin() + partners[i]);
+      solved.erase(solved.begin() + partners[i]);
+    }
+    std::sort(merged.begin(), merged.end());
+    groups.push_back(merged);
+    turns.emplace_back();
+    solved.push_back(false);
+  }
+}
+
+u64 TurnSolver::forEachLegalTurn(const std::function<bool(const std::vector<PackedMove>&)>& visit, u64 limit) {
+  _visit = &visit;
+  _limit = limit;
+  _visited = 0;
+  std::vector<int> moveable = _prepare();
+  u64 key = 0;
+  for (int timeLineID : moveable) {
+    key ^= timeLineSetKey(timeLineID);
+  }
+  _remaining.resize(1);
+  _remaining[0] = moveable;
+  _path.clear();
+  _search(0, key);
+  _visit = nullptr;
+  return _visited;
 }
 
 const std::string NameOfGame<StandardGame>::value = "Standard";
 StandardGame::StandardGame(void) : IGame(Constant::BOARD_SIZE) {
-  _timeLines.push_back(std::make_shared<TimeLine>(dim()));
-  std::shared_ptr<Board> board = std::make_shared<Board>(dim(), _timeLines[0]);
+  _pushBack(_makeTimeLine(0));
+  std::shared_ptr<Board> board = _makeBoard(_timeLines[0]);
   for (int i = 0; i < dim(); i += 1) {
-    board->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board->placePiece({i, 6}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-  }
-  board->placePiece({0, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board->placePiece({1, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board->placePiece({2, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({3, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board->placePiece({4, 0}, std::make_shared<Queen>(PieceColor::PIECEWHITE));
-  board->placePiece({5, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({6, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board->placePiece({7, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-
-  board->placePiece({0, 7}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board->placePiece({1, 7}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({2, 7}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({3, 7}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board->placePiece({4, 7}, std::make_shared<Queen>(PieceColor::PIECEBLACK));
-  board->placePiece({5, 7}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({6, 7}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({7, 7}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  _timeLines[0]->pushBack(board);
+    board->placePiece({i, 1}, WHITE_PAWN);
+    board->placePiece({i, 6}, BLACK_PAWN);
+  }
+  board->placePiece({0, 0}, WHITE_ROOK);
+  board->placePiece({1, 0}, WHITE_KNIGHT);
+  board->placePiece({2, 0}, WHITE_BISHOP);
+  board->placePiece({3, 0}, WHITE_KING);
+  board->placePiece({4, 0}, WHITE_QUEEN);
+  board->placePiece({5, 0}, WHITE_BISHOP);
+  board->placePiece({6, 0}, WHITE_KNIGHT);
+  board->placePiece({7, 0}, WHITE_ROOK);
+
+  board->placePiece({0, 7}, BLACK_ROOK);
+  board->placePiece({1, 7}, BLACK_KNIGHT);
+  board->placePiece({2, 7}, BLACK_BISHOP);
+  board->placePiece({3, 7}, BLACK_KING);
+  board->placePiece({4, 7}, BLACK_QUEEN);
+  board->placePiece({5, 7}, BLACK_BISHOP);
+  board->placePiece({6, 7}, BLACK_KNIGHT);
+  board->placePiece({7, 7}, BLACK_ROOK);
+  _pushBoard(0, board);
 }
 
 const std::string NameOfGame<CustomGameEmitBishop>::value = "Simplify - No Bishop";
 CustomGameEmitBishop::CustomGameEmitBishop(void) : IGame(Constant::BOARD_SIZE_EMIT_BISHOP) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim()));
-  std::shared_ptr<Board> board = std::make_shared<Board>(dim(), _timeLines[0]);
+  _pushBack(_makeTimeLine(0));
+  std::shared_ptr<Board> board = _makeBoard(_timeLines[0]);
   for (int i = 0; i < dim(); i += 1) {
-    board->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board->placePiece({i, 4}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board->placePiece({i, 1}, WHITE_PAWN);
+    board->placePiece({i, 4}, BLACK_PAWN);
   }
-  board->placePiece({0, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board->placePiece({1, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({2, 0}, std::make_shared<Queen>(PieceColor::PIECEWHITE));
-  board->placePiece({3, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board->placePiece({4, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({5, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-
-  board->placePiece({0, 5}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board->placePiece({1, 5}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({2, 5}, std::make_shared<Queen>(PieceColor::PIECEBLACK));
-  board->placePiece({3, 5}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board->placePiece({4, 5}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({5, 5}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  _timeLines[0]->pushBack(board);
+  board->placePiece({0, 0}, WHITE_ROOK);
+  board->placePiece({1, 0}, WHITE_BISHOP);
+  board->placePiece({2, 0}, WHITE_QUEEN);
+  board->placePiece({3, 0}, WHITE_KING);
+  board->placePiece({4, 0}, WHITE_BISHOP);
+  board->placePiece({5, 0}, WHITE_ROOK);
+
+  board->placePiece({0, 5}, BLACK_ROOK);
+  board->placePiece({1, 5}, BLACK_BISHOP);
+  board->placePiece({2, 5}, BLACK_QUEEN);
+  board->placePiece({3, 5}, BLACK_KING);
+  board->placePiece({4, 5}, BLACK_BISHOP);
+  board->placePiece({5, 5}, BLACK_ROOK);
+  _pushBoard(0, board);
 }
 
 const std::string NameOfGame<CustomGameEmitKnight>::value = "Simplify - No Knight";
 CustomGameEmitKnight::CustomGameEmitKnight(void) : IGame(Constant::BOARD_SIZE_EMIT_KNIGHT) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim()));
-  std::shared_ptr<Board> board = std::make_shared<Board>(dim(), _timeLines[0]);
+  _pushBack(_makeTimeLine(0));
+  std::shared_ptr<Board> board = _makeBoard(_timeLines[0]);
   for (int i = 0; i < dim(); i += 1) {
-    board->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board->placePiece({i, 4}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board->placePiece({i, 1}, WHITE_PAWN);
+    board->placePiece({i, 4}, BLACK_PAWN);
   }
-  board->placePiece({0, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board->placePiece({1, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({2, 0}, std::make_shared<Queen>(PieceColor::PIECEWHITE));
-  board->placePiece({3, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board->placePiece({4, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({5, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-
-  board->placePiece({0, 5}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board->placePiece({1, 5}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({2, 5}, std::make_shared<Queen>(PieceColor::PIECEBLACK));
-  board->placePiece({3, 5}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board->placePiece({4, 5}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({5, 5}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  _timeLines[0]->pushBack(board);
+  board->placePiece({0, 0}, WHITE_ROOK);
+  board->placePiece({1, 0}, WHITE_BISHOP);
+  board->placePiece({2, 0}, WHITE_QUEEN);
+  board->placePiece({3, 0}, WHITE_KING);
+  board->placePiece({4, 0}, WHITE_BISHOP);
+  board->placePiece({5, 0}, WHITE_ROOK);
+
+  board->placePiece({0, 5}, BLACK_ROOK);
+  board->placePiece({1, 5}, BLACK_BISHOP);
+  board->placePiece({2, 5}, BLACK_QUEEN);
+  board->placePiece({3, 5}, BLACK_KING);
+  board->placePiece({4, 5}, BLACK_BISHOP);
+  board->placePiece({5, 5}, BLACK_ROOK);
+  _pushBoard(0, board);
 }
 
 const std::string NameOfGame<CustomGameEmitQueen>::value = "Simplify - No Queen";
 CustomGameEmitQueen::CustomGameEmitQueen(void) : IGame(Constant::BOARD_SIZE_EMIT_QUEEN) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim()));
-  std::shared_ptr<Board> board = std::make_shared<Board>(dim(), _timeLines[0]);
+  _pushBack(_makeTimeLine(0));
+  std::shared_ptr<Board> board = _makeBoard(_timeLines[0]);
   for (int i = 0; i < dim(); i += 1) {
-    board->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board->placePiece({i, 5}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-  }
-  board->placePiece({0, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board->placePiece({1, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board->placePiece({2, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({3, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board->placePiece({4, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({5, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board->placePiece({6, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-
-  board->placePiece({0, 6}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board->placePiece({1, 6}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({2, 6}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({3, 6}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board->placePiece({4, 6}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({5, 6}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({6, 6}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  _timeLines[0]->pushBack(board);
+    board->placePiece({i, 1}, WHITE_PAWN);
+    board->placePiece({i, 5}, BLACK_PAWN);
+  }
+  board->placePiece({0, 0}, WHITE_ROOK);
+  board->placePiece({1, 0}, WHITE_KNIGHT);
+  board->placePiece({2, 0}, WHITE_BISHOP);
+  board->placePiece({3, 0}, WHITE_KING);
+  board->placePiece({4, 0}, WHITE_BISHOP);
+  board->placePiece({5, 0}, WHITE_KNIGHT);
+  board->placePiece({6, 0}, WHITE_ROOK);
+
+  board->placePiece({0, 6}, BLACK_ROOK);
+  board->placePiece({1, 6}, BLACK_KNIGHT);
+  board->placePiece({2, 6}, BLACK_BISHOP);
+  board->placePiece({3, 6}, BLACK_KING);
+  board->placePiece({4, 6}, BLACK_BISHOP);
+  board->placePiece({5, 6}, BLACK_KNIGHT);
+  board->placePiece({6, 6}, BLACK_ROOK);
+  _pushBoard(0, board);
 }
 
 const std::string NameOfGame<CustomGameEmitRook>::value = "Simplify - No Rook";
 CustomGameEmitRook::CustomGameEmitRook(void) : IGame(Constant::BOARD_SIZE_EMIT_ROOK) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim()));
-  std::shared_ptr<Board> board = std::make_shared<Board>(dim(), _timeLines[0]);
+  _pushBack(_makeTimeLine(0));
+  std::shared_ptr<Board> board = _makeBoard(_timeLines[0]);
   for (int i = 0; i < dim(); i += 1) {
-    board->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board->placePiece({i, 4}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board->placePiece({i, 1}, WHITE_PAWN);
+    board->placePiece({i, 4}, BLACK_PAWN);
   }
-  board->placePiece({0, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board->placePiece({1, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({2, 0}, std::make_shared<Queen>(PieceColor::PIECEWHITE));
-  board->placePiece({3, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board->placePiece({4, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({5, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-
-  board->placePiece({0, 5}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({1, 5}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({2, 5}, std::make_shared<Queen>(PieceColor::PIECEBLACK));
-  board->placePiece({3, 5}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board->placePiece({4, 5}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board->placePiece({5, 5}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  _timeLines[0]->pushBack(board);
+  board->placePiece({0, 0}, WHITE_KNIGHT);
+  board->placePiece({1, 0}, WHITE_BISHOP);
+  board->placePiece({2, 0}, WHITE_QUEEN);
+  board->placePiece({3, 0}, WHITE_KING);
+  board->placePiece({4, 0}, WHITE_BISHOP);
+  board->placePiece({5, 0}, WHITE_KNIGHT);
+
+  board->placePiece({0, 5}, BLACK_KNIGHT);
+  board->placePiece({1, 5}, BLACK_BISHOP);
+  board->placePiece({2, 5}, BLACK_QUEEN);
+  board->placePiece({3, 5}, BLACK_KING);
+  board->placePiece({4, 5}, BLACK_BISHOP);
+  board->placePiece({5, 5}, BLACK_KNIGHT);
+  _pushBoard(0, board);
 }
 
 const std::string NameOfGame<CustomGameKVB>::value = "Simplify - Knight vs Bishop";
 CustomGameKVB::CustomGameKVB(void) : IGame(Constant::BOARD_SIZE_K_VS_B) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim()));
-  std::shared_ptr<Board> board = std::make_shared<Board>(dim(), _timeLines[0]);
+  _pushBack(_makeTimeLine(0));
+  std::shared_ptr<Board> board = _makeBoard(_timeLines[0]);
   for (int i = 0; i < dim(); i += 1) {
-    board->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board->placePiece({i, 4}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board->placePiece({i, 1}, WHITE_PAWN);
+    board->placePiece({i, 4}, BLACK_PAWN);
   }
-  board->placePiece({0, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board->placePiece({1, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({2, 0}, std::make_shared<Queen>(PieceColor::PIECEWHITE));
-  board->placePiece({3, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board->placePiece({4, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board->placePiece({5, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-
-  board->placePiece({0, 5}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board->placePiece({1, 5}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({2, 5}, std::make_shared<Queen>(PieceColor::PIECEBLACK));
-  board->placePiece({3, 5}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board->placePiece({4, 5}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board->placePiece({5, 5}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  _timeLines[0]->pushBack(board);
+  board->placePiece({0, 0}, WHITE_ROOK);
+  board->placePiece({1, 0}, WHITE_BISHOP);
+  board->placePiece({2, 0}, WHITE_QUEEN);
+  board->placePiece({3, 0}, WHITE_KING);
+  board->placePiece({4, 0}, WHITE_BISHOP);
+  board->placePiece({5, 0}, WHITE_ROOK);
+
+  board->placePiece({0, 5}, BLACK_ROOK);
+  board->placePiece({1, 5}, BLACK_KNIGHT);
+  board->placePiece({2, 5}, BLACK_QUEEN);
+  board->placePiece({3, 5}, BLACK_KING);
+  board->placePiece({4, 5}, BLACK_KNIGHT);
+  board->placePiece({5, 5}, BLACK_ROOK);
+  _pushBoard(0, board);
 }
 
 const std::string NameOfGame<MiscGameTimeLineInvasion>::value = "Misc - Time Line Invasion";
 MiscGameTimeLineInvasion::MiscGameTimeLineInvasion(void) : IGame(Constant::BOARD_SIZE_TIME_LINE_INVASION) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 0));
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 1));
-  std::shared_ptr<Board> board0 = std::make_shared<Board>(dim(), _timeLines[0]);
-  std::shared_ptr<Board> board1 = std::make_shared<Board>(dim(), _timeLines[1]);
-
-  board0->placePiece({0, dim() - 1}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board0->placePiece({1, dim() - 1}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board0->placePiece({2, dim() - 1}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board0->placePiece({3, dim() - 1}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board0->placePiece({4, dim() - 1}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
+  _pushBack(_makeTimeLine(0));
+  _pushBack(_makeTimeLine(1));
+  std::shared_ptr<Board> board0 = _makeBoard(_timeLines[0]);
+  std::shared_ptr<Board> board1 = _makeBoard(_timeLines[1]);
+
+  board0->placePiece({0, dim() - 1}, BLACK_KNIGHT);
+  board0->placePiece({1, dim() - 1}, BLACK_BISHOP);
+  board0->placePiece({2, dim() - 1}, BLACK_KING);
+  board0->placePiece({3, dim() - 1}, BLACK_ROOK);
+  board0->placePiece({4, dim() - 1}, BLACK_BISHOP);
   for (int i = 0; i < dim(); i += 1) {
-    board0->placePiece({i, dim() - 2}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-    board0->placePiece({i, 0}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
+    board0->placePiece({i, dim() - 2}, BLACK_PAWN);
+    board0->placePiece({i, 0}, WHITE_PAWN);
   }
 
-  board1->placePiece({0, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board1->placePiece({1, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board1->placePiece({2, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board1->placePiece({3, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board1->placePiece({4, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
+  board1->placePiece({0, 0}, WHITE_KNIGHT);
+  board1->placePiece({1, 0}, WHITE_BISHOP);
+  board1->placePiece({2, 0}, WHITE_KING);
+  board1->placePiece({3, 0}, WHITE_ROOK);
+  board1->placePiece({4, 0}, WHITE_BISHOP);
   for (int i = 0; i < dim(); i += 1) {
-    board1->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board1->placePiece({i, dim() - 1}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board1->placePiece({i, 1}, WHITE_PAWN);
+    board1->placePiece({i, dim() - 1}, BLACK_PAWN);
   }
-  _timeLines[0]->pushBack(board0);
-  _timeLines[1]->pushBack(board1);
+  _pushBoard(0, board0);
+  _pushBoard(1, board1);
 }
 
 const std::string NameOfGame<MiscGameTimeLineBattle>::value = "Misc - Time Line Battle";
 MiscGameTimeLineBattle::MiscGameTimeLineBattle(void) : IGame(Constant::BOARD_SIZE_TIME_LINE_BATTLE) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 0));
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 1));
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 2));
-  std::shared_ptr<Board> board0 = std::make_shared<Board>(dim(), _timeLines[0]);
-  std::shared_ptr<Board> board1 = std::make_shared<Board>(dim(), _timeLines[1]);
-  std::shared_ptr<Board> board2 = std::make_shared<Board>(dim(), _timeLines[2]);
-
-  board0->placePiece({0, dim() - 1}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board0->placePiece({1, dim() - 1}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board0->placePiece({2, dim() - 1}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board0->placePiece({3, dim() - 1}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board0->placePiece({4, dim() - 1}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-
-  board0->placePiece({0, dim() - 2}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board0->placePiece({1, dim() - 2}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board0->placePiece({2, dim() - 2}, std::make_shared<Queen>(PieceColor::PIECEBLACK));
-  board0->placePiece({3, dim() - 2}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board0->placePiece({4, dim() - 2}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
+  _pushBack(_makeTimeLine(0));
+  _pushBack(_makeTimeLine(1));
+  _pushBack(_makeTimeLine(2));
+  std::shared_ptr<Board> board0 = _makeBoard(_timeLines[0]);
+  std::shared_ptr<Board> board1 = _makeBoard(_timeLines[1]);
+  std::shared_ptr<Board> board2 = _makeBoard(_timeLines[2]);
+
+  board0->placePiece({0, dim() - 1}, BLACK_ROOK);
+  board0->placePiece({1, dim() - 1}, BLACK_ROOK);
+  board0->placePiece({2, dim() - 1}, BLACK_KING);
+  board0->placePiece({3, dim() - 1}, BLACK_ROOK);
+  board0->placePiece({4, dim() - 1}, BLACK_ROOK);
+
+  board0->placePiece({0, dim() - 2}, BLACK_BISHOP);
+  board0->placePiece({1, dim() - 2}, BLACK_BISHOP);
+  board0->placePiece({2, dim() - 2}, BLACK_QUEEN);
+  board0->placePiece({3, dim() - 2}, BLACK_BISHOP);
+  board0->placePiece({4, dim() - 2}, BLACK_BISHOP);
 
   for (int i = 0; i < dim(); i += 1) {
-    board0->placePiece({i, dim() - 3}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-    board0->placePiece({i, 0}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
+    board0->placePiece({i, dim() - 3}, BLACK_PAWN);
+    board0->placePiece({i, 0}, WHITE_PAWN);
   }
 
   for (int i = 0; i < dim(); i += 1) {
-    board1->placePiece({i, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-    board1->placePiece({i, 1}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
+    board1->placePiece({i, 0}, WHITE_KNIGHT);
+    board1->placePiece({i, 1}, WHITE_PAWN);
 
-    board1->placePiece({i, dim() - 1}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-    board1->placePiece({i, dim() - 2}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board1->placePiece({i, dim() - 1}, BLACK_KNIGHT);
+    board1->placePiece({i, dim() - 2}, BLACK_PAWN);
   }
 
-  board2->placePiece({0, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board2->placePiece({1, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board2->placePiece({2, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board2->placePiece({3, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board2->placePiece({4, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
+  board2->placePiece({0, 0}, WHITE_ROOK);
+  board2->placePiece({1, 0}, WHITE_ROOK);
+  board2->placePiece({2, 0}, WHITE_KING);
+  board2->placePiece({3, 0}, WHITE_ROOK);
+  board2->placePiece({4, 0}, WHITE_ROOK);
 
-  board2->placePiece({0, 1}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board2->placePiece({1, 1}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board2->placePiece({2, 1}, std::make_shared<Queen>(PieceColor::PIECEWHITE));
-  board2->placePiece({3, 1}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board2->placePiece({4, 1}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
+  board2->placePiece({0, 1}, WHITE_BISHOP);
+  board2->placePiece({1, 1}, WHITE_BISHOP);
+  board2->placePiece({2, 1}, WHITE_QUEEN);
+  board2->placePiece({3, 1}, WHITE_BISHOP);
+  board2->placePiece({4, 1}, WHITE_BISHOP);
 
   for (int i = 0; i < dim(); i += 1) {
-    board2->placePiece({i, 2}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-    board2->placePiece({i, dim() - 1}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
+    board2->placePiece({i, 2}, WHITE_PAWN);
+    board2->placePiece({i, dim() - 1}, BLACK_PAWN);
   }
 
-  _timeLines[0]->pushBack(board0);
-  _timeLines[1]->pushBack(board1);
-  _timeLines[2]->pushBack(board2);
+  _pushBoard(0, board0);
+  _pushBoard(1, board1);
+  _pushBoard(2, board2);
 }
 
 const std::string NameOfGame<MiscGameTimeLineFragment>::value = "Misc - Time Line Fragment";
 MiscGameTimeLineFragment::MiscGameTimeLineFragment(void) : IGame(Constant::BOARD_SIZE_TIME_LINE_FRAGMENT) {
   _rule.pawnCanMakeTwoMoveOnFirstTurn = false;
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 0, 0));
-  _timeLines.push_back(std::make_shared<TimeLine>(dim(), 1));
-  std::shared_ptr<Board> board0 = std::make_shared<Board>(dim(), _timeLines[0], 1);
-  std::shared_ptr<Board> board1 = std::make_shared<Board>(dim(), _timeLines[1], 0);
-
-  board0->placePiece({0, dim() - 1}, std::make_shared<King>(PieceColor::PIECEBLACK));
-  board0->placePiece({1, dim() - 1}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-  board0->placePiece({2, dim() - 1}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-  board0->placePiece({3, dim() - 1}, std::make_shared<Pawn>(PieceColor::PIECEBLACK));
-  board0->placePiece({0, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-  board0->placePiece({1, 0}, std::make_shared<Bishop>(PieceColor::PIECEWHITE));
-  board0->placePiece({2, 0}, std::make_shared<Rook>(PieceColor::PIECEWHITE));
-  board0->placePiece({3, 0}, std::make_shared<Knight>(PieceColor::PIECEWHITE));
-
-  board1->placePiece({0, 0}, std::make_shared<King>(PieceColor::PIECEWHITE));
-  board1->placePiece({1, 0}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-  board1->placePiece({2, 0}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-  board1->placePiece({3, 0}, std::make_shared<Pawn>(PieceColor::PIECEWHITE));
-  board1->placePiece({0, dim() - 1}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-  board1->placePiece({1, dim() - 1}, std::make_shared<Bishop>(PieceColor::PIECEBLACK));
-  board1->placePiece({2, dim() - 1}, std::make_shared<Rook>(PieceColor::PIECEBLACK));
-  board1->placePiece({3, dim() - 1}, std::make_shared<Knight>(PieceColor::PIECEBLACK));
-
-  _timeLines[0]->pushBack(board0);
-  _timeLines[1]->pushBack(board1);
+  _pushBack(_makeTimeLine(0, 0));
+  _pushBack(_makeTimeLine(1));
+  std::shared_ptr<Board> board0 = _makeBoard(_timeLines[0], 1);
+  std::shared_ptr<Board> board1 = _makeBoard(_timeLines[1], 0);
+
+  board0->placePiece({0, dim() - 1}, BLACK_KING);
+  board0->placePiece({1, dim() - 1}, BLACK_PAWN);
+  board0->placePiece({2, dim() - 1}, BLACK_PAWN);
+  board0->placePiece({3, dim() - 1}, BLACK_PAWN);
+  board0->placePiece({0, 0}, WHITE_KNIGHT);
+  board0->placePiece({1, 0}, WHITE_BISHOP);
+  board0->placePiece({2, 0}, WHITE_ROOK);
+  board0->placePiece({3, 0}, WHITE_KNIGHT);
+
+  board1->placePiece({0, 0}, WHITE_KING);
+  board1->placePiece({1, 0}, WHITE_PAWN);
+  board1->placePiece({2, 0}, WHITE_PAWN);
+  board1->placePiece({3, 0}, WHITE_PAWN);
+  board1->placePiece({0, dim() - 1}, BLACK_KNIGHT);
+  board1->placePiece({1, dim() - 1}, BLACK_BISHOP);
+  board1->placePiece({2, dim() - 1}, BLACK_ROOK);
+  board1->placePiece({3, dim() - 1}, BLACK_KNIGHT);
+
+  _pushBoard(0, board0);
+  _pushBoard(1, board1);
 }
 
 const int Constant::BOARD_SIZE = 8;
@@ -0,0 +1,276 @@
+// Counts the move sequences of a variant to a fixed depth, to benchmark and cross-check move generation.
+// Only depends on the engine (chess.h / chess.cpp), see the README for how to build it.
+#include "chess.h"
+#include "variants.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace Chess;
+using namespace Tools;
+
+namespace {
+
+/**
+ * Counts the leaves of the move tree of a game.
+ * A ply is one move. Once the player has moved on every board of the present the turn is submitted, which
+ * is not a ply. The game is walked with doMove / doSubmit and restored on the way back.
+ */
+class Perft {
+public:
+  Perft(IGame& game, MoveFilter filter, std::size_t hashBytes) : _game(game), _filter(filter), _overflowed(false) {
+    std::size_t entries = 1;
+    while (entries * 2 * sizeof(_Entry) <= hashBytes) {
+      entries *= 2;
+    }
+    if (hashBytes >= sizeof(_Entry)) {
+      _table.resize(entries);
+    }
+  }
+
+  /**
+   * Count the move sequences of a length.
+   * @param depth The number of plies.
+   * @param divide Called with every move of the root and the number of sequences starting with it.
+   * @return The number of sequences.
+   */
+  u64 run(int depth, const std::function<void(PackedMove, u64)>& divide = nullptr) {
+    _buffers.resize(std::max<std::size_t>(_buffers.size(), depth + 1));
+    if (depth == 0) {
+      return 1;
+    }
+    MoveBuffer& moves = _buffers[depth];
+    moves.clear();
+    int generated = _game.generateAllMoves(moves, _filter);
+    _overflowed = _overflowed or generated > moves.size();
+    if (_verify) {
+      _verifyMoves(moves);
+    }
+    u64 nodes = 0;
+    for (PackedMove move : moves) {
+      u64 count = _child(move, depth);
+      if (divide) {
+        divide(move, count);
+      }
+      nodes += count;
+    }
+    return nodes;
+  }
+
+  /**
+   * Check the LEGAL moves of every position walked against a reference: the pseudo-legal moves that do not
+   * leave the player in check once made (doMove / isInCheck / undoMove).
+   */
+  inline void setVerify(bool verify) {
+    _verify = verify;
+  }
+
+  /**
+   * Get the number of positions whose LEGAL moves differed from the reference, when verifying.
+   */
+  inline u64 mismatches(void) const {
+    return _mismatches;
+  }
+
+  /**
+   * Check whether a position had more moves than a MoveBuffer holds, in which case the counts are too low.
+   */
+  inline bool overflowed(void) const {
+    return _overflowed;
+  }
+
+  inline u64 hashHits(void) const {
+    return _hits;
+  }
+private:
+  struct _Entry {
+    u64 key = 0;
+    u64 nodes = 0;
+  };
+
+  IGame& _game;
+  MoveFilter _filter;
+  std::vector<MoveBuffer> _buffers; // one per remaining depth, so the recursion does not allocate
+  std::vector<_Entry> _table; // empty when caching is off
+  bool _overflowed;
+  u64 _hits = 0;
+  bool _verify = false;
+  u64 _mismatches = 0;
+  MoveBuffer _pseudo; // scratch space of _verifyMoves
+  std::vector<u64> _expected;
+  std::vector<u64> _found;
+
+  /**
+   * Compare the moves generated for the current position with the reference, see setVerify.
+   * @param moves The moves generated with the LEGAL filter.
+   */
+  void _verifyMoves(const MoveBuffer& moves) {
+    _pseudo.clear();
+    _game.generateAllMoves(_pseudo, MoveFilter::PSEUDO_LEGAL);
+    PieceColor mover = _game.getCurrentTurnColor();
+    _expected.clear();
+    for (PackedMove move : _pseudo) {
+      _game.doMove(move);
+      if (not _game.isInCheck(mover)) {
+        _expected.push_back(move.bits());
+      }
+      _game.undoMove();
+    }
+    _found.clear();
+    for (PackedMove move : moves) {
+      _found.push_back(move.bits());
+    }
+    std::sort(_expected.begin(), _expected.end());
+    std::sort(_found.begin(), _found.end());
+    if (_expected == _found) {
+      return;
+    }
+    _mismatches += 1;
+    if (_mismatches > 3) {
+      return;
+    }
+    std::printf("mismatch at hash %016llx:\n", (unsigned long long)_game.hash());
+    for (PackedMove move : _pseudo) {
+      bool expected = std::binary_search(_expected.begin(), _expected.end(), move.bits());
+      bool found = std::binary_search(_found.begin(), _found.end(), move.bits());
+      if (expected != found) {
+        std::printf("  %s %s\n", moveName(move).c_str(), expected ? "is legal but was dropped" : "is illegal but was kept");
+      }
+    }
+  }
+
+  u64 _child(PackedMove move, int depth) {
+    _game.doMove(move);
+    bool submitted = not _game.hasMoveableBoards();
+    if (submitted) {
+      _game.doSubmit();
+    }
+    u64 nodes = _count(depth - 1);
+    if (submitted) {
+      _game.undoSubmit();
+    }
+    _game.undoMove();
+    return nodes;
+  }
+
+  u64 _count(int depth) {
+    if (depth == 0) {
+      return 1;
+    }
+    if (_game.gameEnd()) {
+      return 0;
+    }
+    // the depth is part of the key, a subtree is only reused for the same number of plies
+    u64 key = _game.hash() ^ Zobrist::mix(u64(depth) << 32 | 0x9e3779b9ULL);
+    _Entry* entry = _table.empty() ? nullptr : &_table[key & (_table.size() - 1)];
+    if (entry != nullptr and entry->key == key) {
+      _hits += 1;
+      return entry->nodes;
+    }
+
+    MoveBuffer& moves = _buffers[depth];
+    moves.clear();
+    int generated = _game.generateAllMoves(moves, _filter);
+    if (_verify) {
+      _verifyMoves(moves);
+    }
+    u64 nodes = 0;
+    if (depth == 1) {
+      // every move is a leaf, no need to make it, and the count is exact even if the buffer filled up
+      nodes = generated;
+    } else {
+      _overflowed = _overflowed or generated > moves.size();
+      for (PackedMove move : moves) {
+        nodes += _child(move, depth);
+      }
+    }
+
+    if (entry != nullptr) {
+      *entry = _Entry{key, nodes};
+    }
+    return nodes;
+  }
+};
+
+void usage(const char* program) {
+  std::printf("usage: %s [--variant KEY] [--divide] [--hash MB] [--pseudo] [--verify] DEPTH\n", program);
+  std::printf("  --variant KEY  the starting position, one of:\n");
+  printVariants();
+  std::printf("  --divide       print the number of sequences after each move of the root\n");
+  std::printf("  --hash MB      cache subtree counts by Zobrist key in a table of that size\n");
+  std::printf("  --pseudo       count pseudo-legal moves instead of legal ones\n");
+  std::printf("  --verify       check the legal moves of every position against making each pseudo-legal move\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const Variant* variant = &variants().front();
+  bool divide = false;
+  std::size_t hashBytes = 0;
+  MoveFilter filter = MoveFilter::LEGAL;
+  bool verify = false;
+  int depth = -1;
+  for (int i = 1; i < argc; i += 1) {
+    if (std::strcmp(argv[i], "--variant") == 0 and i + 1 < argc) {
+      const char* key = argv[++i];
+      variant = findVariant(key);
+      if (variant == nullptr) {
+        std::fprintf(stderr, "unknown variant %s\n", key);
+        usage(argv[0]);
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--divide") == 0) {
+      divide = true;
+    } else if (std::strcmp(argv[i], "--hash") == 0 and i + 1 < argc) {
+      hashBytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+    } else if (std::strcmp(argv[i], "--pseudo") == 0) {
+      filter = MoveFilter::PSEUDO_LEGAL;
+    } else if (std::strcmp(argv[i], "--verify") == 0) {
+      verify = true;
+    } else if (argv[i][0] != '-' and depth < 0) {
+      depth = std::atoi(argv[i]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (depth < 0 or (verify and filter != MoveFilter::LEGAL)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::shared_ptr<IGame> game = variant->create();
+  Perft perft(*game, filter, hashBytes);
+  perft.setVerify(verify);
+  std::printf("%s, %s moves\n", variant->name.c_str(), filter == MoveFilter::LEGAL ? "legal" : "pseudo-legal");
+  for (int ply = 1; ply <= depth; ply += 1) {
+    bool last = ply == depth;
+    auto start = std::chrono::steady_clock::now();
+    u64 nodes = perft.run(ply, last and divide ? [](PackedMove move, u64 count) {
+      std::printf("  %s: %llu\n", moveName(move).c_str(), (unsigned long long)count);
+    } : std::function<void(PackedMove, u64)>(nullptr));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("perft(%d) = %llu in %.3f s, %.0f nodes/s\n", ply, (unsigned long long)nodes, seconds,
+                seconds > 0 ? nodes / seconds : 0.0);
+  }
+  if (hashBytes > 0) {
+    std::printf("hash hits: %llu\n", (unsigned long long)perft.hashHits());
+  }
+  if (verify) {
+    std::printf("positions with wrong legal moves: %llu\n", (unsigned long long)perft.mismatches());
+    if (perft.mismatches() > 0) {
+      return 3;
+    }
+  }
+  if (perft.overflowed()) {
+    std::printf("warning: a position had more than %d moves, the counts are too low\n", MoveBuffer::CAPACITY);
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,165 @@
+// Runs a search engine on a variant, to benchmark it and watch it play against itself.
+// Only depends on the engine (chess.h / chess.cpp and src/Engine), see the README for how to build it.
+#include "chess.h"
+#include "variants.h"
+#include "Engine/AlphaBetaEngine.h"
+#include "Engine/MCTSEngine.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using namespace Chess;
+using namespace Tools;
+
+namespace {
+
+std::string turnName(const std::vector<PackedMove>& turn) {
+  std::string name;
+  for (PackedMove move : turn) {
+    name += (name.empty() ? "" : " ") + moveName(move);
+  }
+  return name.empty() ? "(none)" : name;
+}
+
+/**
+ * Search the starting positions of a few variants with more and more threads, and print the nodes per second.
+ * Each search gets the same time and a cleared table, so the speedup is the one of the raw search speed.
+ */
+template <class Engine>
+void bench(Engine& engine, const SearchLimits& limits, int maxThreads) {
+  static const char* const keys[] = {"standard", "invasion", "battle", "fragment"};
+  double base = 0;
+  std::printf("%8s %14s %12s %14s %8s\n", "threads", "nodes", "seconds", "nodes/s", "speedup");
+  for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+    engine.setThreads(threads);
+    u64 nodes = 0;
+    double seconds = 0;
+    for (const char* key : keys) {
+      std::shared_ptr<IGame> game = findVariant(key)->create();
+      if constexpr (requires { engine.clear(); }) {
+        engine.clear();
+      }
+      SearchResult result = engine.findBestTurn(*game, limits);
+      nodes += result.nodes;
+      seconds += result.seconds;
+    }
+    double speed = seconds > 0 ? nodes / seconds : 0.0;
+    base = threads == 1 ? speed : base;
+    std::printf("%8d %14llu %12.3f %14.0f %7.2fx\n", threads, (unsigned long long)nodes, seconds, speed,
+                base > 0 ? speed / base : 0.0);
+    if (threads == maxThreads) break;
+  }
+}
+
+/**
+ * Search the variant once, or play it against itself, or benchmark the engine.
+ */
+template <class Engine>
+void run(Engine& engine, const Variant& variant, SearchLimits limits, int turns, bool benchmark, int threads) {
+  if (benchmark) {
+    if (limits.depth <= 0 and limits.time.count() <= 0 and limits.nodes == 0) {
+      limits.time = std::chrono::milliseconds(1000);
+    }
+    bench(engine, limits, threads > 0 ? threads : std::max(1, int(std::thread::hardware_concurrency())));
+    return;
+  }
+  if (limits.depth <= 0 and limits.time.count() <= 0 and limits.nodes == 0) {
+    limits.depth = 3;
+  }
+
+  std::shared_ptr<IGame> game = variant.create();
+  std::printf("%s, %s, %d thread%s\n", variant.name.c_str(), engine.name().c_str(), engine.threads(),
+              engine.threads() > 1 ? "s" : "");
+  for (int turn = 0; turn < turns and not game->gameEnd(); turn += 1) {
+    SearchResult result = engine.findBestTurn(*game, limits);
+    std::printf("%s: %s\n", game->getCurrentTurnColor() == PieceColor::PIECEWHITE ? "white" : "black",
+                turnName(result.turn).c_str());
+    std::printf("  depth %d, score %d, %llu nodes in %.3f s, %.0f nodes/s\n", result.depth, result.score,
+                (unsigned long long)result.nodes, result.seconds, result.seconds > 0 ? result.nodes / result.seconds : 0.0);
+    if (result.turn.empty()) {
+      break;
+    }
+    for (PackedMove move : result.turn) {
+      game->doMove(move);
+    }
+    game->submitTurn();
+  }
+}
+
+void usage(const char* program) {
+  std::printf("usage: %s [--variant KEY] [--engine NAME] [--depth TURNS] [--time MS] [--nodes N] [--threads N]\n", program);
+  std::printf("       %*s [--hash MB] [--playout TURNS] [--play TURNS | --bench]\n", int(std::strlen(program)), "");
+  std::printf("  --variant KEY  the starting position, one of:\n");
+  printVariants();
+  std::printf("  --engine NAME  alphabeta (default) or mcts\n");
+  std::printf("  --depth TURNS  the number of turns searched by alphabeta, 3 when no limit is given\n");
+  std::printf("  --time MS      stop each search after that many milliseconds\n");
+  std::printf("  --nodes N      stop each search after that many moves\n");
+  std::printf("                 mcts runs %llu playouts when no limit is given\n", (unsigned long long)MCTSEngine::DEFAULT_ITERATIONS);
+  std::printf("  --threads N    search with N threads (Lazy SMP or parallel playouts), 1 by default\n");
+  std::printf("  --hash MB      the size of the alphabeta transposition table, %zu by default\n", AlphaBetaEngine::DEFAULT_HASH_MEGABYTES);
+  std::printf("  --playout TURNS  the turns of each mcts playout, %d by default\n", PlayoutPolicy().turns);
+  std::printf("  --play TURNS   play that many turns against itself instead of searching once\n");
+  std::printf("  --bench        measure nodes per second from 1 to N threads (all cores by default), 1 s per search\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const Variant* variant = &variants().front();
+  SearchLimits limits;
+  std::string engineName = "alphabeta";
+  PlayoutPolicy policy;
+  int turns = 1;
+  int threads = 0;
+  std::size_t hashMegabytes = AlphaBetaEngine::DEFAULT_HASH_MEGABYTES;
+  bool benchmark = false;
+  for (int i = 1; i < argc; i += 1) {
+    if (std::strcmp(argv[i], "--variant") == 0 and i + 1 < argc) {
+      const char* key = argv[++i];
+      variant = findVariant(key);
+      if (variant == nullptr) {
+        std::fprintf(stderr, "unknown variant %s\n", key);
+        usage(argv[0]);
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--engine") == 0 and i + 1 < argc) {
+      engineName = argv[++i];
+      if (engineName != "alphabeta" and engineName != "mcts") {
+        std::fprintf(stderr, "unknown engine %s\n", engineName.c_str());
+        usage(argv[0]);
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--depth") == 0 and i + 1 < argc) {
+      limits.depth = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--time") == 0 and i + 1 < argc) {
+      limits.time = std::chrono::milliseconds(std::atoll(argv[++i]));
+    } else if (std::strcmp(argv[i], "--nodes") == 0 and i + 1 < argc) {
+      limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--threads") == 0 and i + 1 < argc) {
+      threads = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--hash") == 0 and i + 1 < argc) {
+      hashMegabytes = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--playout") == 0 and i + 1 < argc) {
+      policy.turns = std::max(0, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--play") == 0 and i + 1 < argc) {
+      turns = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--bench") == 0) {
+      benchmark = true;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (engineName == "mcts") {
+    MCTSEngine engine(std::max(threads, 1));
+    engine.setPlayoutPolicy(policy);
+    run(engine, *variant, limits, turns, benchmark, threads);
+  } else {
+    AlphaBetaEngine engine(std::max(threads, 1), hashMegabytes);
+    run(engine, *variant, limits, turns, benchmark, threads);
+  }
+  return 0;
+}
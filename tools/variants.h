@@ -0,0 +1,70 @@
+// The starting positions and move notation shared by the command line tools.
+#pragma once
+
+#include "chess.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Tools {
+
+struct Variant {
+  const char* key;
+  const std::string& name;
+  std::function<std::shared_ptr<Chess::IGame>(void)> create;
+};
+
+inline const std::vector<Variant>& variants(void) {
+  using namespace Chess;
+  static const std::vector<Variant> list = {
+    {"standard", NameOfGame<StandardGame>::value, createGame<StandardGame>},
+    {"no-bishop", NameOfGame<CustomGameEmitBishop>::value, createGame<CustomGameEmitBishop>},
+    {"no-knight", NameOfGame<CustomGameEmitKnight>::value, createGame<CustomGameEmitKnight>},
+    {"no-queen", NameOfGame<CustomGameEmitQueen>::value, createGame<CustomGameEmitQueen>},
+    {"no-rook", NameOfGame<CustomGameEmitRook>::value, createGame<CustomGameEmitRook>},
+    {"kvb", NameOfGame<CustomGameKVB>::value, createGame<CustomGameKVB>},
+    {"invasion", NameOfGame<MiscGameTimeLineInvasion>::value, createGame<MiscGameTimeLineInvasion>},
+    {"battle", NameOfGame<MiscGameTimeLineBattle>::value, createGame<MiscGameTimeLineBattle>},
+    {"fragment", NameOfGame<MiscGameTimeLineFragment>::value, createGame<MiscGameTimeLineFragment>},
+  };
+  return list;
+}
+
+/**
+ * Find a variant by its key or its name.
+ * @return The variant, nullptr if there is none.
+ */
+inline const Variant* findVariant(const std::string& key) {
+  for (const Variant& variant : variants()) {
+    if (key == variant.key or key == variant.name) {
+      return &variant;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Print the keys and names of the variants, for usage messages.
+ */
+inline void printVariants(void) {
+  for (const Variant& variant : variants()) {
+    std::printf("                   %-10s %s\n", variant.key, variant.name.c_str());
+  }
+}
+
+/**
+ * Write a square in 5D notation, (timeline T full turn) then the square, e.g. (0T1)e2.
+ */
+inline std::string squareName(int timeLine, int halfTurn, Chess::Position2D position) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "(%dT%d)%c%d", timeLine, halfTurn / 2 + 1, 'a' + position.x(), position.y() + 1);
+  return buffer;
+}
+
+inline std::string moveName(Chess::PackedMove move) {
+  return squareName(move.fromTimeLine(), move.fromHalfTurn(), move.from()) + "-"
+       + squareName(move.toTimeLine(), move.toHalfTurn(), move.to());
+}
+
+} // namespace Tools